@@ -0,0 +1,52 @@
+#include <chrono>
+#include <new>
+#include "../include/mapped_file.h"
+#include "../include/parser.h"
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: alloc_bench <file.svm>" << std::endl;
+        exit(1);
+    }
+    MappedFile file(argv[1]);
+    if (!file.is_open()) {
+        std::cout << "Unable to open file " << argv[1] << std::endl;
+        exit(1);
+    }
+
+    size_t before = allocations;
+    size_t tokens = 0;
+    Scanner scanner(file.view());
+    for (Token token = scanner.next_token(); token.type != Token::END; token = scanner.next_token()) tokens++;
+    size_t scan_allocations = allocations - before;
+
+    before = allocations;
+    Scanner parse_scanner(file.view());
+    Parser parser(&parse_scanner);
+    auto start = std::chrono::steady_clock::now();
+    Program program;
+    Status status = parser.parseProgram(program);
+    SVM svm(std::move(program));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t parse_allocations = allocations - before;
+
+    std::cout << "tokens              " << tokens << std::endl;
+    std::cout << "scan_allocations    " << scan_allocations << std::endl;
+    std::cout << "allocs/token        " << (double)scan_allocations / (tokens ? tokens : 1) << std::endl;
+    std::cout << "parse_allocations   " << parse_allocations << std::endl;
+    std::cout << "parse_allocs/token  " << (double)parse_allocations / (tokens ? tokens : 1) << std::endl;
+    std::cout << "parse_seconds       " << seconds << std::endl;
+    if (!status.ok()) std::cout << "parse_error         " << status.message << std::endl;
+    return 0;
+}
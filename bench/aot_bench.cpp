@@ -0,0 +1,61 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include "../include/transpiler.h"
+#include "programs.h"
+
+// Interpreter vs. --emit-cpp binary on the ejemplo2 loop. The translation unit is built with
+// $CXX (default c++) at -O3; compile time is reported separately from run time.
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::stol(argv[1]) : 100000000;
+    long body = argc > 2 ? std::stol(argv[2]) : 0;
+    const char* cxx = std::getenv("CXX") ? std::getenv("CXX") : "c++";
+    std::string source = "/tmp/aot_program.cpp", binary = "/tmp/aot_program", output = "/tmp/aot_program.out";
+
+    std::string text = loop_program(iterations, body);
+    Program program = parse_text(text);
+    {
+        std::ofstream out(source);
+        emit_cpp(program, out);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string command = std::string(cxx) + " -O3 -o " + binary + " " + source;
+    if (std::system(command.c_str()) != 0) {
+        std::cout << "Failed: " << command << std::endl;
+        return 1;
+    }
+    double compile_seconds = elapsed(start);
+
+    SVM svm(std::move(program));
+    start = std::chrono::steady_clock::now();
+    svm.execute();
+    double interpreter_seconds = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+    if (std::system((binary + " > " + output).c_str()) != 0) {
+        std::cout << "Failed: " << binary << std::endl;
+        return 1;
+    }
+    double native_seconds = elapsed(start);
+
+    std::string native_result;
+    std::getline(std::ifstream(output), native_result);
+
+    std::cout << "iterations      " << iterations << std::endl;
+    std::cout << "body            " << body << std::endl;
+    std::cout << "interpreter     " << interpreter_seconds << " s" << std::endl;
+    std::cout << "aot compile     " << compile_seconds << " s" << std::endl;
+    std::cout << "aot run         " << native_seconds << " s" << std::endl;
+    std::cout << "speedup         " << interpreter_seconds / native_seconds << "x" << std::endl;
+    int result = 0;
+    svm.top(result);
+    std::cout << "result          " << result << " / " << native_result << std::endl;
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include <chrono>
+#include <string>
+#include "../include/batch.h"
+#include "programs.h"
+
+// Batch throughput over 1..64 threads: sums 1..r5 for `inputs` input sets with r5 in
+// [0, spread), so runs have uneven lengths and the pool has to steal to stay balanced.
+// Speedup is relative to the single-thread row.
+
+const char* sum_program =
+    "push 0\n"
+    "LENTRY: load 5\npush 0\njmple LEND\n"
+    "load 5\nadd\n"
+    "load 5\npush 1\nsub\nstore 5\n"
+    "goto LENTRY\n"
+    "LEND: skip\n";
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? std::stol(argv[1]) : 100000;
+    int spread = argc > 2 ? std::stoi(argv[2]) : 2000;
+    std::string engine = argc > 3 ? argv[3] : "stack";
+
+    std::shared_ptr<Executable> executable = std::make_shared<Executable>(parse_text(sum_program));
+    if (engine == "jit" && !executable->enable_jit()) engine = "stack";
+
+    std::vector<BatchInput> inputs(count, BatchInput());
+    for (long i = 0; i < count; i++) inputs[i].registers[5] = (i * 7919) % spread;
+
+    std::cout << "inputs          " << count << std::endl;
+    std::cout << "engine          " << engine << std::endl;
+    std::cout << "hardware        " << std::thread::hardware_concurrency() << " threads" << std::endl;
+
+    double baseline = 0;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        WorkStealingPool pool(threads);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> outputs = run_batch(executable, inputs, pool);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) baseline = seconds;
+        std::cout << "threads " << threads << (threads < 10 ? "       " : "      ") << count / seconds
+                  << " runs/s, speedup " << baseline / seconds << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <chrono>
+#include "programs.h"
+
+// Compares single-stepping through SVM::step() with the threaded SVM::execute() loop.
+// Build with -DSVM_NO_COMPUTED_GOTO to measure the portable switch dispatcher instead.
+double run(const std::string& text, bool stepping, int& result) {
+    SVM svm(parse_text(text));
+
+    auto start = std::chrono::steady_clock::now();
+    if (stepping) {
+        while (svm.step());
+    } else {
+        svm.execute();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result = 0;
+    svm.top(result);
+    return seconds;
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::stol(argv[1]) : 10000000;
+    std::string text = loop_program(iterations, 0);
+    double executed = loop_program_length(iterations, 0);
+
+    int step_result, threaded_result;
+    double step_seconds = run(text, true, step_result);
+    double threaded_seconds = run(text, false, threaded_result);
+
+#ifdef SVM_COMPUTED_GOTO
+    const char* dispatcher = "computed-goto";
+#else
+    const char* dispatcher = "switch";
+#endif
+    std::cout << "dispatcher      " << dispatcher << std::endl;
+    std::cout << "executed        " << (long)executed << std::endl;
+    std::cout << "step_instr/s    " << (long)(executed / step_seconds) << std::endl;
+    std::cout << "execute_instr/s " << (long)(executed / threaded_seconds) << std::endl;
+    std::cout << "speedup         " << step_seconds / threaded_seconds << std::endl;
+    std::cout << "results_match   " << (step_result == threaded_result ? "yes" : "no") << std::endl;
+    return 0;
+}
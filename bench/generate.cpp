@@ -0,0 +1,30 @@
+#include <fstream>
+#include <iostream>
+#include "generator.h"
+
+// Writes a synthetic SM program to a file or stdout; the output is streamed, so sizes in the
+// gigabytes do not need to fit in memory.
+
+int main(int argc, char** argv) {
+    ProgramKind kind;
+    if (argc < 3 || !parse_program_kind(argv[1], kind)) {
+        std::cout << "usage: svm_generate <straight|loops|labels|comments> <size[K|M|G]> [seed] [out.svm]"
+                  << std::endl;
+        exit(1);
+    }
+    size_t bytes = parse_size(argv[2]);
+    uint64_t seed = argc > 3 ? std::stoull(argv[3]) : 1;
+
+    ProgramGenerator generator(kind, seed);
+    if (argc > 4) {
+        std::ofstream out(argv[4], std::ios::binary);
+        if (!out) {
+            std::cout << "Unable to open file " << argv[4] << std::endl;
+            exit(1);
+        }
+        generator.generate(bytes, out);
+    } else {
+        generator.generate(bytes, std::cout);
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+#ifndef Syntax_Analysis_BENCH_GENERATOR_H
+#define Syntax_Analysis_BENCH_GENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Seeded generator of large valid SM programs for the benchmarks. Output is a pure function of
+// (kind, size, seed): it draws from its own xorshift generator rather than <random>
+// distributions, whose results differ between standard libraries. Every program parses, passes
+// verification and halts; values only ever come from small non-negative literals.
+//
+//   straight  long runs of stack-balanced arithmetic and register traffic, no labels
+//   loops     blocks of nested counting loops (depth 3 by default, counters in r1-r7)
+//   labels    every unit labelled with a long name, and forward jumps between units
+//   comments  straight-line code interleaved with comment lines, blank lines and indentation
+enum class ProgramKind { STRAIGHT, LOOPS, LABELS, COMMENTS };
+
+const char* program_kind_names[] = { "straight", "loops", "labels", "comments" };
+
+bool parse_program_kind(const std::string& name, ProgramKind& kind) {
+    for (int i = 0; i < 4; i++) {
+        if (name == program_kind_names[i]) {
+            kind = static_cast<ProgramKind>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Accepts a byte count with an optional K, M or G suffix (powers of 1024).
+size_t parse_size(const std::string& text) {
+    size_t end = 0;
+    double value = std::stod(text, &end);
+    char unit = end < text.size() ? text[end] : ' ';
+    if (unit == 'k' || unit == 'K') value *= 1024;
+    else if (unit == 'm' || unit == 'M') value *= 1024 * 1024;
+    else if (unit == 'g' || unit == 'G') value *= 1024.0 * 1024 * 1024;
+    return static_cast<size_t>(value);
+}
+
+class ProgramGenerator {
+private:
+    ProgramKind kind;
+    uint64_t state;
+    long unit;
+    int depth;
+
+    uint64_t next();
+    int below(int);
+    void straight_unit(std::string&);
+    void loop_unit(std::string&);
+    void label_unit(std::string&);
+    void comment_unit(std::string&);
+    std::string label_name(long);
+    void emit_unit(std::string&);
+    void emit_end(std::string&);
+
+public:
+    ProgramGenerator(ProgramKind, uint64_t seed, int depth = 3);
+    void generate(size_t bytes, std::ostream&);
+    std::string generate(size_t bytes);
+};
+
+ProgramGenerator::ProgramGenerator(ProgramKind kind, uint64_t seed, int depth)
+    : kind(kind), state(seed * 0x9E3779B97F4A7C15ull + 1), unit(0), depth(depth < 1 ? 1 : depth > 7 ? 7 : depth) {}
+
+uint64_t ProgramGenerator::next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+int ProgramGenerator::below(int n) { return static_cast<int>(next() % n); }
+
+// Each unit starts and ends at stack depth 0, so any unit boundary is a valid jump target.
+void ProgramGenerator::straight_unit(std::string& out) {
+    int r = below(8), s = below(8);
+    switch (below(6)) {
+        case 0: out += "push " + std::to_string(below(100)) + "\npush " + std::to_string(below(100)) + "\nadd\n"; break;
+        case 1: out += "load " + std::to_string(r) + "\npush " + std::to_string(below(10)) + "\nsub\n"; break;
+        case 2: out += "load " + std::to_string(r) + "\nload " + std::to_string(s) + "\nswap\nsub\n"; break;
+        case 3: out += "push " + std::to_string(below(10)) + "\ndup\nmul\n"; break;
+        case 4: out += "load " + std::to_string(r) + "\npush " + std::to_string(1 + below(9)) + "\ndiv\n"; break;
+        default: out += "push " + std::to_string(below(1000)) + "\nskip\n"; break;
+    }
+    out += "store " + std::to_string(s) + "\n";
+}
+
+std::string ProgramGenerator::label_name(long n) {
+    static const char* stems[] = { "entry", "loop_head", "check", "body", "exit_path", "merge_point" };
+    return std::string(stems[n % 6]) + "_" + std::to_string(n);
+}
+
+// `depth` loops nested inside each other, each counting r<level> down from a small trip count;
+// the innermost body bumps r0.
+void ProgramGenerator::loop_unit(std::string& out) {
+    std::string block = "B" + std::to_string(unit);
+    for (int level = 1; level <= depth; level++) {
+        std::string name = block + "_L" + std::to_string(level);
+        out += "push " + std::to_string(2 + below(4)) + "\nstore " + std::to_string(level) + "\n";
+        out += name + ": load " + std::to_string(level) + "\npush 0\njmple " + name + "_end\n";
+    }
+    out += "load 0\npush 1\nadd\nstore 0\n";
+    for (int level = depth; level >= 1; level--) {
+        std::string name = block + "_L" + std::to_string(level);
+        out += "load " + std::to_string(level) + "\npush 1\nsub\nstore " + std::to_string(level) + "\n";
+        out += "goto " + name + "\n" + name + "_end: skip\n";
+    }
+}
+
+// Forward jumps only, to one of the next few units, so the program always runs to the end.
+// The final unit's `label_name(unit + k)` targets are defined by the terminator generate() adds.
+void ProgramGenerator::label_unit(std::string& out) {
+    static const char* jumps[] = { "jmpeq", "jmpgt", "jmpge", "jmplt", "jmple" };
+    out += label_name(unit) + ": ";
+    switch (below(3)) {
+        case 0: out += "goto " + label_name(unit + 1) + "\n"; break;
+        case 1:
+            out += "push " + std::to_string(below(10)) + "\n" + label_name(unit) + "_b: push " +
+                   std::to_string(below(10)) + "\n" + jumps[below(5)] + " " + label_name(unit + 1 + below(3)) + "\n";
+            break;
+        default:
+            out += "load " + std::to_string(below(8)) + "\nstore " + std::to_string(below(8)) + "\n";
+            break;
+    }
+}
+
+// `%` comments must sit on their own lines: the scanner skips a comment together with its
+// newline, so a trailing comment would swallow the instruction's <eol>.
+void ProgramGenerator::comment_unit(std::string& out) {
+    static const char* words[] = { "accumulate", "the", "running", "total", "into", "register", "before",
+                                   "checking", "bounds", "again", "%", "--", "TODO", "x = y + 1;" };
+    if (below(2) == 0) {
+        out += "% ";
+        for (int i = 0, n = 3 + below(10); i < n; i++) out += std::string(words[below(14)]) + " ";
+        out += "\n";
+    }
+    std::string code;
+    this->straight_unit(code);
+    size_t line = 0;
+    while (line < code.size()) {
+        size_t end = code.find('\n', line);
+        if (below(3) == 0) out += below(2) ? "\t" : "    ";
+        out.append(code, line, end + 1 - line);
+        line = end + 1;
+    }
+    if (below(8) == 0) out += "\n";
+}
+
+void ProgramGenerator::emit_unit(std::string& out) {
+    switch (kind) {
+        case ProgramKind::STRAIGHT: this->straight_unit(out); break;
+        case ProgramKind::LOOPS: this->loop_unit(out); break;
+        case ProgramKind::LABELS: this->label_unit(out); break;
+        case ProgramKind::COMMENTS: this->comment_unit(out); break;
+    }
+    unit++;
+}
+
+void ProgramGenerator::emit_end(std::string& out) {
+    if (kind == ProgramKind::LABELS) {
+        for (int k = 0; k < 3; k++) out += label_name(unit + k) + ": skip\n";
+    }
+    out += "skip\n";
+}
+
+// Writes units until at least `bytes` have been produced, in pieces of about 1 MB.
+void ProgramGenerator::generate(size_t bytes, std::ostream& out) {
+    std::string piece;
+    size_t written = 0;
+    while (written < bytes) {
+        piece.clear();
+        while (piece.size() < (1 << 20) && written + piece.size() < bytes) this->emit_unit(piece);
+        out << piece;
+        written += piece.size();
+    }
+    piece.clear();
+    this->emit_end(piece);
+    out << piece;
+}
+
+std::string ProgramGenerator::generate(size_t bytes) {
+    std::string text;
+    text.reserve(bytes + 4096);
+    while (text.size() < bytes) this->emit_unit(text);
+    this->emit_end(text);
+    return text;
+}
+
+#endif // Syntax_Analysis_BENCH_GENERATOR_H
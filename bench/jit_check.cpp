@@ -0,0 +1,72 @@
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include "../include/optimizer.h"
+#include "../include/parser.h"
+
+// Differential check of the JIT against the interpreter: every program is run both ways at each
+// optimization level and the print output plus final stack must match byte for byte. With no
+// arguments every .svm file under source/ is checked. Exits non-zero on any mismatch.
+
+std::string run(std::string_view text, int level, bool use_jit, bool& compiled) {
+    Scanner scanner(text);
+    Parser parser(&scanner);
+    Program program;
+    parser.parseProgram(program);
+    SVM svm(optimize(std::move(program), level));
+    compiled = use_jit && svm.enable_jit();
+
+    std::ostringstream out;
+    std::streambuf* saved = std::cout.rdbuf(out.rdbuf());
+    Status status = svm.execute();
+    if (status.ok()) svm.print_stack();
+    else std::cout << "error: " << status.message << std::endl;
+    std::cout.rdbuf(saved);
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) paths.push_back(argv[i]);
+    if (paths.empty()) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("source")) {
+            if (entry.path().extension() == ".svm") paths.push_back(entry.path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+    }
+
+    int failures = 0;
+    for (const std::string& path : paths) {
+        MappedFile file(path);
+        if (!file.is_open()) {
+            std::cout << "FAIL " << path << ": cannot open" << std::endl;
+            failures++;
+            continue;
+        }
+        Scanner scanner(file.view());
+        Parser parser(&scanner);
+        Program parsed;
+        Status status = parser.parseProgram(parsed);
+        if (!status.ok()) {
+            std::cout << "skip " << path << ": " << status.message << std::endl;
+            continue;
+        }
+        if (!verify(parsed).ok) {
+            std::cout << "skip " << path << ": not verified, never compiled" << std::endl;
+            continue;
+        }
+
+        for (int level = 0; level <= 2; level++) {
+            bool compiled;
+            std::string expected = run(file.view(), level, false, compiled);
+            std::string actual = run(file.view(), level, true, compiled);
+            const char* status = !compiled ? "FAIL" : expected == actual ? "ok  " : "FAIL";
+            std::cout << status << " " << path << " -O" << level;
+            if (!compiled) std::cout << ": JIT unavailable";
+            else if (expected != actual) std::cout << ": interpreter\n" << expected << "jit\n" << actual;
+            std::cout << std::endl;
+            if (!compiled || expected != actual) failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <string>
+#include "../include/embedded.h"
+#include "programs.h"
+
+// An embedded kernel against the same text loaded at startup: the loop_program() loop, counting
+// down from ten million, as a literal. The first rows time what loading costs at startup, parse
+// and verify, which the kernel does at build time; the others run the program on the stack
+// interpreter, the JIT where there is one, and KernelVM. Best of `repeats` runs.
+//
+// usage: kernel_bench [repeats]
+
+constexpr std::string_view loop_source =
+    "push 10000000\nstore 5\npush 0\n"
+    "LENTRY: load 5\npush 0\njmple LEND\npush 1\nadd\n"
+    "load 5\npush 1\nsub\nstore 5\ngoto LENTRY\nLEND: skip\n";
+constexpr auto loop_kernel = SVM_KERNEL(loop_source);
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int repeats = argc > 1 ? std::stoi(argv[1]) : 5;
+    double executed = loop_program_length(10000000, 0);
+
+    double parse = 1e9, load = 1e9;
+    std::shared_ptr<Executable> executable;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        Program program = parse_text(loop_source);
+        parse = std::min(parse, elapsed(start));
+        start = std::chrono::steady_clock::now();
+        executable = std::make_shared<Executable>(std::move(program));
+        load = std::min(load, elapsed(start));
+    }
+    std::cout << "instructions    " << loop_kernel.size() << std::endl;
+    std::cout << "startup parse   " << parse * 1e6 << " us" << std::endl;
+    std::cout << "startup verify  " << load * 1e6 << " us" << std::endl;
+    std::cout << "startup kernel  0 us" << std::endl;
+
+    const char* engines[] = { "interpreter", "jit", "kernel" };
+    for (const char* engine : engines) {
+        std::string name = engine;
+        SVM svm(executable);
+        if (name == "jit" && !svm.enable_jit()) continue;
+        double best = 1e9;
+        int result = 0;
+        for (int r = 0; r < repeats; r++) {
+            auto start = std::chrono::steady_clock::now();
+            if (name == "kernel") {
+                KernelVM<loop_kernel> vm;
+                OutputSink out(std::cout);
+                vm.run(out);
+                best = std::min(best, elapsed(start));
+                result = vm.stack[vm.depth - 1];
+            } else {
+                svm.reset(nullptr, std::vector<int>());
+                svm.execute();
+                best = std::min(best, elapsed(start));
+                svm.top(result);
+            }
+        }
+        name.resize(16, ' ');
+        std::cout << name << best << " s, " << static_cast<long>(executed / best) << " instructions/s, result "
+                  << result << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <chrono>
+#include <string>
+#include "../include/lanes.h"
+#include "../include/optimizer.h"
+#include "programs.h"
+
+// Scalar batch vs. lockstep lanes on one thread, summing 1..r5 per input. With spread 1 every
+// input runs the same trip count and lanes never diverge; larger spreads make lanes leave the
+// loop at different times and idle until the whole group is done. Throughput is reported in
+// instructions x lanes per second, the same unit for both engines.
+
+const char* sum_program =
+    "push 0\n"
+    "LENTRY: load 5\npush 0\njmple LEND\n"
+    "load 5\nadd\n"
+    "load 5\npush 1\nsub\nstore 5\n"
+    "goto LENTRY\n"
+    "LEND: skip\n";
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? std::stol(argv[1]) : 20000;
+    int trips = argc > 2 ? std::stoi(argv[2]) : 1000;
+    int spread = argc > 3 ? std::stoi(argv[3]) : 1;
+    int level = argc > 4 ? std::stoi(argv[4]) : 0;
+
+    std::shared_ptr<Executable> executable = std::make_shared<Executable>(optimize(parse_text(sum_program), level));
+
+    std::vector<BatchInput> inputs(count, BatchInput());
+    for (long i = 0; i < count; i++) inputs[i].registers[5] = trips + (i * 7919) % spread;
+
+    WorkStealingPool pool(1);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> scalar = run_batch(executable, inputs, pool);
+    double scalar_seconds = elapsed(start);
+
+    long long executed = 0;
+    start = std::chrono::steady_clock::now();
+    std::vector<std::string> vector = run_batch_lanes(executable, inputs, pool, &executed);
+    double lane_seconds = elapsed(start);
+
+    std::cout << "inputs          " << count << std::endl;
+    std::cout << "trips           " << trips << " + [0, " << spread << ")" << std::endl;
+    std::cout << "lanes           " << LaneVM::LANES << std::endl;
+    std::cout << "lane-instrs     " << executed << std::endl;
+    std::cout << "scalar          " << scalar_seconds << " s, " << executed / scalar_seconds << " instrs x lanes/s"
+              << std::endl;
+    std::cout << "lockstep        " << lane_seconds << " s, " << executed / lane_seconds << " instrs x lanes/s"
+              << std::endl;
+    std::cout << "speedup         " << scalar_seconds / lane_seconds << "x" << std::endl;
+    std::cout << "outputs match   " << (scalar == vector ? "yes" : "NO") << std::endl;
+    return scalar == vector ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "generator.h"
+
+// Load test for `svm --serve <socket>`. The cold phase sends `requests` distinct generated
+// programs, so every one is a cache miss and pays the full front end; the warm phase sends the
+// first of them `requests` times, so every one is a hit. Each phase is spread over `connections`
+// client threads, one connection each, sending requests back to back. Reports latency
+// percentiles per phase and the server's cache counters.
+//
+// usage: load_client <socket> [requests] [connections] [size[K|M]] [kind]
+
+struct Client {
+    int fd;
+    std::string buffer;
+
+    bool connect_to(const std::string& path) {
+        sockaddr_un address = sockaddr_un();
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        return fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    bool send_all(const std::string& data) {
+        for (size_t done = 0; done < data.size();) {
+            ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+
+    bool fill() {
+        char chunk[64 * 1024];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) return false;
+        buffer.append(chunk, n);
+        return true;
+    }
+
+    // Sends one request and reads back `<status> <length>\n<payload>`.
+    bool request(const std::string& message, std::string& status, std::string& payload) {
+        if (!this->send_all(message)) return false;
+        size_t newline;
+        while ((newline = buffer.find('\n')) == std::string::npos) if (!this->fill()) return false;
+        std::string header = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+        size_t space = header.find(' ');
+        if (space == std::string::npos) return false;
+        status = header.substr(0, space);
+        size_t length = std::stoul(header.substr(space + 1));
+        while (buffer.size() < length) if (!this->fill()) return false;
+        payload = buffer.substr(0, length);
+        buffer.erase(0, length);
+        return true;
+    }
+};
+
+std::string run_request(const std::string& source) {
+    return "RUN 0 " + std::to_string(source.size()) + "\n" + source + "\n";
+}
+
+struct Phase {
+    std::vector<double> latencies;
+    double seconds;
+    size_t failures;
+};
+
+// Sends messages[i % messages.size()] for i in [0, count) over `connections` threads.
+Phase run_phase(const std::string& path, const std::vector<std::string>& messages, size_t count, int connections) {
+    Phase phase;
+    phase.latencies.assign(count, 0);
+    std::vector<size_t> failures(connections, 0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < connections; c++) {
+        threads.emplace_back([&, c]() {
+            Client client;
+            if (!client.connect_to(path)) {
+                failures[c] = count;
+                return;
+            }
+            std::string status, payload;
+            for (size_t i = c; i < count; i += connections) {
+                auto sent = std::chrono::steady_clock::now();
+                bool ok = client.request(messages[i % messages.size()], status, payload) && status == "ok";
+                phase.latencies[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - sent).count();
+                if (!ok) failures[c]++;
+            }
+            close(client.fd);
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    phase.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    phase.failures = 0;
+    for (size_t f : failures) phase.failures += f;
+    std::sort(phase.latencies.begin(), phase.latencies.end());
+    return phase;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+void report(const char* name, const Phase& phase) {
+    std::cout << name << " requests=" << phase.latencies.size() << " per_s=" << phase.latencies.size() / phase.seconds
+              << " p50_us=" << percentile(phase.latencies, 0.50) * 1e6
+              << " p99_us=" << percentile(phase.latencies, 0.99) * 1e6
+              << " max_us=" << (phase.latencies.empty() ? 0 : phase.latencies.back() * 1e6)
+              << " failures=" << phase.failures << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: load_client <socket> [requests] [connections] [size[K|M]] [kind]" << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    size_t requests = argc > 2 ? std::stoul(argv[2]) : 1000;
+    int connections = argc > 3 ? std::stoi(argv[3]) : 4;
+    size_t size = argc > 4 ? parse_size(argv[4]) : 16 << 10;
+    ProgramKind kind = ProgramKind::LOOPS;
+    if (argc > 5 && !parse_program_kind(argv[5], kind)) {
+        std::cout << "Unknown program kind " << argv[5] << std::endl;
+        return 1;
+    }
+    if (requests == 0 || connections < 1) return 1;
+
+    // The leading comment makes every program new to a server that has already seen this seed.
+    std::vector<std::string> cold;
+    std::string salt = std::to_string(getpid()) + "." +
+                       std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    for (size_t i = 0; i < requests; i++) {
+        cold.push_back(run_request("% load_client " + salt + " " + std::to_string(i) + "\n" +
+                                   ProgramGenerator(kind, i + 1).generate(size)));
+    }
+
+    std::cout << std::fixed;
+    std::cout << "# load_client requests=" << requests << " connections=" << connections << " size=" << size
+              << " kind=" << program_kind_names[static_cast<int>(kind)] << std::endl;
+    Phase cold_phase = run_phase(path, cold, requests, connections);
+    report("cold", cold_phase);
+    Phase warm_phase = run_phase(path, std::vector<std::string>(1, cold[0]), requests, connections);
+    report("warm", warm_phase);
+
+    Client client;
+    std::string status, payload;
+    if (client.connect_to(path) && client.request("STATS\n", status, payload)) std::cout << "server " << payload;
+    return cold_phase.failures + warm_phase.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include <chrono>
+#include <string>
+#include "../include/parallel_parser.h"
+#include "programs.h"
+
+// Sequential Parser vs. ParallelParser on 1..64 threads over one large in-memory source: the
+// ejemplo2 loop with `body` push/pop pairs, repeated `copies` times under distinct labels.
+// Each parallel result is compared word for word with the sequential program.
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool same_program(const Program& a, const Program& b) {
+    if (a.size() != b.size() || a.debug.labels != b.debug.labels) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a.data()[i].opcode != b.data()[i].opcode || a.data()[i].operand != b.data()[i].operand) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    long copies = argc > 1 ? std::stol(argv[1]) : 20000;
+    long body = argc > 2 ? std::stol(argv[2]) : 100;
+    size_t chunk_size = argc > 3 ? std::stoul(argv[3]) : 1 << 20;
+
+    std::string text;
+    for (long i = 0; i < copies; i++) {
+        std::string copy = loop_program(10, body), suffix = "_" + std::to_string(i);
+        for (const char* label : { "LENTRY", "LEND" }) {
+            for (size_t at = copy.find(label); at != std::string::npos; at = copy.find(label, at + 1))
+                copy.insert(at + std::string(label).size(), suffix);
+        }
+        text += copy;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Program sequential = parse_text(text);
+    double sequential_seconds = elapsed(start);
+
+    std::cout << "source          " << text.size() / 1e6 << " MB, " << sequential.size() << " instructions"
+              << std::endl;
+    std::cout << "hardware        " << std::thread::hardware_concurrency() << " threads" << std::endl;
+    std::cout << "sequential      " << sequential_seconds << " s, " << text.size() / 1e6 / sequential_seconds
+              << " MB/s" << std::endl;
+
+    bool all_same = true;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        WorkStealingPool pool(threads);
+        ParallelParser parallel(text, pool, chunk_size);
+        start = std::chrono::steady_clock::now();
+        Program program;
+        Status status = parallel.parseProgram(program);
+        double seconds = elapsed(start);
+        bool same = status.ok() && same_program(sequential, program);
+        all_same = all_same && same;
+        std::cout << "threads " << threads << (threads < 10 ? "       " : "      ") << seconds << " s, speedup "
+                  << sequential_seconds / seconds << "x" << (same ? "" : ", DIFFERENT PROGRAM") << std::endl;
+    }
+    return all_same ? 0 : 1;
+}
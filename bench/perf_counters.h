@@ -0,0 +1,76 @@
+#ifndef Syntax_Analysis_PERF_COUNTERS_H
+#define Syntax_Analysis_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters for the calling thread. Counters the kernel refuses to open read as -1.
+class PerfCounters {
+private:
+    static const int COUNT = 3;
+    int fds[COUNT];
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    void start();
+    void stop();
+    int64_t instructions();
+    int64_t cache_misses();
+    int64_t l1d_misses();
+
+private:
+    int64_t read_counter(int);
+};
+
+PerfCounters::PerfCounters() {
+    const uint64_t configs[COUNT][2] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    };
+    for (int i = 0; i < COUNT; i++) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = configs[i][0];
+        attr.config = configs[i][1];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int i = 0; i < COUNT; i++) if (fds[i] >= 0) close(fds[i]);
+}
+
+void PerfCounters::start() {
+    for (int i = 0; i < COUNT; i++) {
+        if (fds[i] < 0) continue;
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void PerfCounters::stop() {
+    for (int i = 0; i < COUNT; i++) if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+}
+
+int64_t PerfCounters::read_counter(int i) {
+    int64_t value;
+    if (fds[i] < 0 || read(fds[i], &value, sizeof(value)) != sizeof(value)) return -1;
+    return value;
+}
+
+int64_t PerfCounters::instructions() { return this->read_counter(0); }
+int64_t PerfCounters::cache_misses() { return this->read_counter(1); }
+int64_t PerfCounters::l1d_misses() { return this->read_counter(2); }
+
+#endif // Syntax_Analysis_PERF_COUNTERS_H
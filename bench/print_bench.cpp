@@ -0,0 +1,80 @@
+#include <chrono>
+#include <fstream>
+#include <string>
+#include "programs.h"
+
+// Print-heavy throughput: a loop that prints a stack of `depth` values `prints` times, written
+// to /dev/null so only formatting and the calls into the stream are measured. The first row is
+// the way SVM::print_stack() used to print, operator<< per value and std::endl per line, on the
+// same stack without running the VM; the others run the program through an OutputSink. Best of
+// `repeats` runs.
+//
+// usage: print_bench [prints] [depth] [repeats]
+
+std::string print_program(long prints, int depth) {
+    std::string text;
+    for (int i = 0; i < depth; i++) text += "push " + std::to_string(i * 1000003 + 100000000) + "\n";
+    text += "push " + std::to_string(prints) + "\nstore 0\n";
+    text += "LOOP: load 0\npush 0\njmple END\nprint\nload 0\npush 1\nsub\nstore 0\ngoto LOOP\nEND: skip\n";
+    return text;
+}
+
+void report(const char* name, long prints, double seconds, double bytes) {
+    std::cout << name << " " << seconds << " s, " << static_cast<long>(prints / seconds) << " prints/s, "
+              << bytes / seconds / (1 << 20) << " MB/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    long prints = argc > 1 ? std::stol(argv[1]) : 1000000;
+    int depth = argc > 2 ? std::stoi(argv[2]) : 8;
+    int repeats = argc > 3 ? std::stoi(argv[3]) : 3;
+    std::shared_ptr<Executable> executable = std::make_shared<Executable>(parse_text(print_program(prints, depth)));
+    std::ofstream null("/dev/null");
+
+    std::vector<int> stack;
+    for (int i = 0; i < depth; i++) stack.push_back(i * 1000003 + 100000000);
+    std::cout << "prints          " << prints << std::endl;
+    std::cout << "depth           " << depth << std::endl;
+
+    double best = 1e9;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (long p = 0; p < prints; p++) {
+            null << "stack [ ";
+            for (int i = depth - 1; i >= 0; i--) null << stack[i] << " ";
+            null << "]" << std::endl;
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::string line = "stack [ ";
+    for (int i = depth - 1; i >= 0; i--) line += std::to_string(stack[i]) + " ";
+    line += "]\n";
+    report("ostream_endl   ", prints, best, static_cast<double>(line.size()) * prints);
+
+    struct Variant {
+        const char* name;
+        size_t threshold;
+        OutputSink::Format format;
+        double bytes;
+    };
+    Variant variants[] = {
+        { "sink_unbuffered", 0, OutputSink::TEXT, static_cast<double>(line.size()) },
+        { "sink_text      ", 64 * 1024, OutputSink::TEXT, static_cast<double>(line.size()) },
+        { "sink_binary    ", 64 * 1024, OutputSink::BINARY, 4.0 * (depth + 1) },
+    };
+    SVM svm(executable);
+    for (const Variant& variant : variants) {
+        OutputSink sink(null, variant.threshold, variant.format);
+        svm.set_output(sink);
+        best = 1e9;
+        for (int r = 0; r < repeats; r++) {
+            svm.reset(nullptr, std::vector<int>());
+            auto start = std::chrono::steady_clock::now();
+            svm.execute();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        report(variant.name, prints, best, variant.bytes * prints);
+        svm.set_output(null);
+    }
+    return 0;
+}
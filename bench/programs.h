@@ -0,0 +1,35 @@
+#ifndef Syntax_Analysis_BENCH_PROGRAMS_H
+#define Syntax_Analysis_BENCH_PROGRAMS_H
+
+#include <string>
+#include "../include/parser.h"
+
+// The loop from ejemplo2.svm, counting down from `iterations`, with `body` extra
+// push/pop pairs in the loop body to grow the code footprint.
+std::string loop_program(long iterations, long body) {
+    std::string text = "push " + std::to_string(iterations) + "\nstore 5\npush 0\n";
+    text += "LENTRY: load 5\npush 0\njmple LEND\npush 1\nadd\n";
+    for (long i = 0; i < body; i++) text += "push 1\npop\n";
+    text += "load 5\npush 1\nsub\nstore 5\ngoto LENTRY\nLEND: skip\n";
+    return text;
+}
+
+// Number of instructions loop_program() executes.
+double loop_program_length(long iterations, long body) {
+    return 3 + iterations * (10.0 + 2 * body) + 4;
+}
+
+// Parses a program the benchmark built itself; a parse error is a bug in the benchmark.
+Program parse_text(std::string_view text) {
+    Scanner scanner(text);
+    Parser parser(&scanner);
+    Program program;
+    Status status = parser.parseProgram(program);
+    if (!status.ok()) {
+        std::cout << status.message << std::endl;
+        exit(1);
+    }
+    return program;
+}
+
+#endif // Syntax_Analysis_BENCH_PROGRAMS_H
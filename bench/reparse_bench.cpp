@@ -0,0 +1,87 @@
+#include <chrono>
+#include <string>
+#include "../include/incremental.h"
+#include "generator.h"
+#include "programs.h"
+
+// Edit latency of IncrementalCompiler::update() against a full parse of the same source, for
+// generated programs of growing size. Every edit is made at a random `push` line and undone
+// again, so the source keeps its size: replacing the line, inserting two instructions before
+// it and deleting them, and inserting a labelled one and deleting it. Verification of the
+// whole program is left to executable() and timed on its own, as `verify`. The final program
+// is compared word for word with a full parse.
+//
+// usage: reparse_bench [kind] [max size] [edits]
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool same_program(const Program& a, const Program& b) {
+    if (a.size() != b.size() || a.debug.labels != b.debug.labels) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a.data()[i].opcode != b.data()[i].opcode || a.data()[i].operand != b.data()[i].operand) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ProgramKind kind = ProgramKind::LOOPS;
+    if (argc > 1 && !parse_program_kind(argv[1], kind)) {
+        std::cout << "unknown program kind " << argv[1] << std::endl;
+        return 1;
+    }
+    size_t max_size = argc > 2 ? parse_size(argv[2]) : 16 << 20;
+    int edits = argc > 3 ? std::stoi(argv[3]) : 200;
+
+    std::cout << "kind            " << program_kind_names[static_cast<int>(kind)] << std::endl;
+    bool all_same = true;
+    for (size_t size = 64 << 10; size <= max_size; size *= 4) {
+        std::string text = ProgramGenerator(kind, 1).generate(size);
+        std::vector<size_t> push_lines;
+        size_t line = 0;
+        for (size_t at = 0; at < text.size(); at = text.find('\n', at) + 1, line++) {
+            size_t first = text.find_first_not_of(" \t", at);
+            if (text.compare(first, 5, "push ") == 0) push_lines.push_back(line);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Program full = parse_text(text);
+        double full_seconds = elapsed(start);
+
+        IncrementalCompiler compiler;
+        compiler.compile(text);
+        double replace = 0, insert = 0, remove = 0, label = 0;
+        uint64_t seed = 88172645463325252ull;
+        for (int e = 0; e < edits; e++) {
+            seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+            size_t at = push_lines[seed % push_lines.size()];
+            start = std::chrono::steady_clock::now();
+            compiler.update(at, 1, "push 3\n");
+            replace += elapsed(start);
+            start = std::chrono::steady_clock::now();
+            compiler.update(at, 0, "push 1\npop\n");
+            insert += elapsed(start);
+            start = std::chrono::steady_clock::now();
+            compiler.update(at, 2, "");
+            remove += elapsed(start);
+            start = std::chrono::steady_clock::now();
+            Status status = compiler.update(at, 0, "bench_label: skip\n");
+            compiler.update(at, 1, "");
+            label += elapsed(start) / 2;
+            if (!status.ok()) std::cout << status.message << std::endl;
+        }
+        start = std::chrono::steady_clock::now();
+        compiler.executable();
+        double verify = elapsed(start);
+
+        bool same = same_program(parse_text(compiler.source()), compiler.executable()->program);
+        all_same = all_same && same;
+        double ms = 1000.0 / edits;
+        std::cout << size / 1024 << " KB, " << full.size() << " instructions: full parse " << full_seconds * 1000
+                  << " ms; update " << replace * ms << " ms replace, " << insert * ms << " ms insert, " << remove * ms
+                  << " ms delete, " << label * ms << " ms label; verify " << verify * 1000 << " ms"
+                  << (same ? "" : ", DIFFERENT PROGRAM") << std::endl;
+    }
+    return all_same ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include "../include/mapped_file.h"
+#include "../include/scanner.h"
+
+long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+size_t scan_all(std::string_view input) {
+    Scanner scanner(input);
+    size_t tokens = 0;
+    Token token = scanner.next_token();
+    while (token.type != Token::END) {
+        tokens++;
+        token = scanner.next_token();
+    }
+    return tokens;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: scanner_bench <file.svm> [--copy]" << std::endl;
+        exit(1);
+    }
+    bool copy = argc > 2 && std::string(argv[2]) == "--copy";
+
+    auto start = std::chrono::steady_clock::now();
+    size_t tokens, bytes;
+    if (copy) {
+        std::ifstream t(argv[1]);
+        std::stringstream buffer;
+        buffer << t.rdbuf();
+        std::string text = buffer.str();
+        bytes = text.size();
+        tokens = scan_all(text);
+    } else {
+        MappedFile file(argv[1]);
+        if (!file.is_open()) {
+            std::cout << "Unable to open file " << argv[1] << std::endl;
+            exit(1);
+        }
+        bytes = file.view().size();
+        tokens = scan_all(file.view());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "mode        " << (copy ? "copy" : "mmap") << std::endl;
+    std::cout << "bytes       " << bytes << std::endl;
+    std::cout << "tokens      " << tokens << std::endl;
+    std::cout << "seconds     " << seconds << std::endl;
+    std::cout << "tokens/s    " << (size_t)(tokens / seconds) << std::endl;
+    std::cout << "MB/s        " << bytes / seconds / 1e6 << std::endl;
+    std::cout << "peak_rss_kb " << peak_rss_kb() << std::endl;
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <string>
+#include "../include/scheduler.h"
+#include "programs.h"
+
+// Scheduling overhead: the same instances, summing 1..r5, run to completion by run_batch() and
+// time-sliced by the Scheduler at several quanta, on the same number of threads. Each time is the
+// best of `repeats` runs. Overhead is relative to run_batch(); outputs must match.
+
+const char* sum_program =
+    "push 0\n"
+    "LENTRY: load 5\npush 0\njmple LEND\n"
+    "load 5\nadd\n"
+    "load 5\npush 1\nsub\nstore 5\n"
+    "goto LENTRY\n"
+    "LEND: skip\n";
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? std::stol(argv[1]) : 10000;
+    int trips = argc > 2 ? std::stoi(argv[2]) : 20000;
+    int threads = argc > 3 ? std::stoi(argv[3]) : std::thread::hardware_concurrency();
+    int repeats = argc > 4 ? std::stoi(argv[4]) : 3;
+
+    std::shared_ptr<Executable> executable = std::make_shared<Executable>(parse_text(sum_program));
+    std::vector<BatchInput> inputs(count, BatchInput());
+    for (long i = 0; i < count; i++) inputs[i].registers[5] = trips + (i * 7919) % 1000;
+
+    WorkStealingPool pool(threads);
+    std::vector<std::string> expected;
+    double direct_seconds = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        expected = run_batch(executable, inputs, pool);
+        direct_seconds = std::min(direct_seconds, elapsed(start));
+    }
+
+    std::cout << "instances       " << count << std::endl;
+    std::cout << "trips           " << trips << " + [0, 1000)" << std::endl;
+    std::cout << "threads         " << pool.size() << std::endl;
+    std::cout << "run_batch       " << direct_seconds << " s" << std::endl;
+
+    bool all_match = true;
+    for (long long quantum : { 1000LL, 10000LL, 100000LL }) {
+        double seconds = 1e30;
+        bool match = true;
+        long long slices = 0;
+        for (int r = 0; r < repeats; r++) {
+            Scheduler scheduler(threads, quantum);
+            auto start = std::chrono::steady_clock::now();
+            for (const BatchInput& input : inputs) scheduler.submit(executable, input);
+            scheduler.run();
+            seconds = std::min(seconds, elapsed(start));
+
+            slices = 0;
+            for (long i = 0; i < count; i++) {
+                match = match && scheduler.result(i).output == expected[i];
+                slices += scheduler.result(i).slices;
+            }
+        }
+        all_match = all_match && match;
+        std::cout << "quantum " << quantum << std::string(8 - std::to_string(quantum).size(), ' ') << seconds << " s, "
+                  << slices << " slices, overhead " << (seconds / direct_seconds - 1) * 100 << "%"
+                  << (match ? "" : ", OUTPUTS DIFFER") << std::endl;
+    }
+    return all_match ? 0 : 1;
+}
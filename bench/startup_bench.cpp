@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "../include/image.h"
+#include "programs.h"
+
+// Straight-line program with a label every 8 instructions and jumps spread over the labels.
+std::string synthetic_program(long count) {
+    const char* unary[] = { "add", "sub", "dup", "swap", "pop", "skip" };
+    std::string text;
+    for (long i = 0; i < count; i++) {
+        if (i % 8 == 0) text += "L" + std::to_string(i) + ": ";
+        if (i % 5 == 0) text += "push " + std::to_string(i % 1000) + "\n";
+        else if (i % 7 == 0) text += "jmple L" + std::to_string((i * 31 % count) & ~7L) + "\n";
+        else if (i % 11 == 0) text += "load " + std::to_string(i % 8) + "\n";
+        else text += std::string(unary[i % 6]) + "\n";
+    }
+    return text;
+}
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? std::stol(argv[1]) : 1000000;
+    std::string text_path = "/tmp/startup_bench.svm", image_path = "/tmp/startup_bench.svmb";
+
+    std::string text = synthetic_program(count);
+    FILE* f = fopen(text_path.c_str(), "wb");
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t text_size;
+    {
+        MappedFile file(text_path);
+        Program program = parse_text(file.view());
+        text_size = program.size();
+        if (!write_image(program, image_path, true).ok()) {
+            std::cout << "Unable to write " << image_path << std::endl;
+            return 1;
+        }
+    }
+    double compile_seconds = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+    {
+        MappedFile file(text_path);
+        Program program = parse_text(file.view());
+    }
+    double text_seconds = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+    std::unique_ptr<MappedFile> file(new MappedFile(image_path));
+    Program loaded;
+    Status status = load_image(std::move(file), loaded);
+    if (!status.ok()) {
+        std::cout << status.message << std::endl;
+        return 1;
+    }
+    double image_seconds = elapsed(start);
+
+    std::cout << "instructions    " << text_size << " / " << loaded.size() << std::endl;
+    std::cout << "text_bytes      " << text.size() << std::endl;
+    std::cout << "compile_s       " << compile_seconds << std::endl;
+    std::cout << "text_startup_s  " << text_seconds << std::endl;
+    std::cout << "image_startup_s " << image_seconds << std::endl;
+    std::cout << "speedup         " << text_seconds / image_seconds << std::endl;
+
+    std::remove(text_path.c_str());
+    std::remove(image_path.c_str());
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include <chrono>
+#include <iomanip>
+#include <new>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "generator.h"
+#include "programs.h"
+
+// Microbenchmarks of each front-end and VM stage over generated programs of every kind:
+//
+//   scan     Scanner::next_token over the whole text              count = tokens
+//   parse    Parser::parseProgram, labels resolved                count = instructions
+//   resolve  Parser::resolveLabels alone, after an untimed parse  count = jumps patched
+//   load     SVM construction: verification and stack sizing      count = instructions
+//   execute  SVM::execute, uncounted interpreter                  count = instructions executed
+//
+// Every benchmark runs in a child process that generates its own source, so peak_rss_kb is the
+// high-water mark of that source plus the stage under test. Output is one line of key=value pairs
+// per benchmark, with the same keys on every line, meant to be diffed between versions.
+//
+// usage: bench_suite [size[K|M|G]] [seed] [kind...]
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct Measurement {
+    size_t bytes, count, allocations;
+    double seconds;
+};
+
+struct Benchmark {
+    const char* name;
+    const char* unit;
+    Measurement (*run)(const std::string&);
+};
+
+// Splits Parser::parseProgram so label resolution can be timed on its own.
+class ParserBenchmark {
+public:
+    static size_t parse_unresolved(Parser& parser) {
+        parser.current = parser.scanner->next_token();
+        parser.parseInstructions();
+        return parser.jumps.size();
+    }
+    static void resolve(Parser& parser) { parser.resolveLabels(); }
+};
+
+double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Measurement bench_scan(const std::string& text) {
+    size_t before = allocations, tokens = 0;
+    auto start = std::chrono::steady_clock::now();
+    Scanner scanner(text);
+    for (Token token = scanner.next_token(); token.type != Token::END; token = scanner.next_token()) tokens++;
+    return Measurement{ text.size(), tokens, allocations - before, elapsed(start) };
+}
+
+Measurement bench_parse(const std::string& text) {
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    Scanner scanner(text);
+    Parser parser(&scanner);
+    Program program;
+    parser.parseProgram(program);
+    return Measurement{ text.size(), program.size(), allocations - before, elapsed(start) };
+}
+
+Measurement bench_resolve(const std::string& text) {
+    Scanner scanner(text);
+    Parser parser(&scanner);
+    size_t jumps = ParserBenchmark::parse_unresolved(parser);
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    ParserBenchmark::resolve(parser);
+    return Measurement{ text.size(), jumps, allocations - before, elapsed(start) };
+}
+
+Measurement bench_load(const std::string& text) {
+    Program program = parse_text(text);
+    size_t size = program.size(), before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    SVM svm(std::move(program));
+    return Measurement{ text.size(), size, allocations - before, elapsed(start) };
+}
+
+// A counted run first finds how many instructions the program executes; the timed run is the
+// plain interpreter that `svm file` uses.
+Measurement bench_execute(const std::string& text) {
+    SVM svm(parse_text(text));
+    std::ostream discard(nullptr);
+    svm.set_output(discard);
+    svm.count_instructions(true);
+    svm.execute();
+    size_t executed = svm.source_instructions_executed();
+    svm.count_instructions(false);
+    svm.reset(nullptr, std::vector<int>());
+
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    svm.execute();
+    return Measurement{ text.size(), executed, allocations - before, elapsed(start) };
+}
+
+const Benchmark benchmarks[] = {
+    { "scan", "tokens", bench_scan },
+    { "parse", "instructions", bench_parse },
+    { "resolve", "jumps", bench_resolve },
+    { "load", "instructions", bench_load },
+    { "execute", "instructions", bench_execute },
+};
+
+// Runs one benchmark in a child, which sends its measurement back through a pipe.
+bool run_isolated(const Benchmark& benchmark, ProgramKind kind, size_t size, uint64_t seed, Measurement& result,
+                  long& peak_rss_kb) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    std::cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        Measurement measurement = benchmark.run(ProgramGenerator(kind, seed).generate(size));
+        ssize_t written = write(fds[1], &measurement, sizeof(measurement));
+        _exit(written == sizeof(measurement) ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = child > 0 && read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (child > 0 && wait4(child, &status, 0, &usage) == child) peak_rss_kb = usage.ru_maxrss;
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv) {
+    size_t size = argc > 1 ? parse_size(argv[1]) : 16 << 20;
+    uint64_t seed = argc > 2 ? std::stoull(argv[2]) : 1;
+    std::vector<ProgramKind> kinds;
+    for (int i = 3; i < argc; i++) {
+        ProgramKind kind;
+        if (!parse_program_kind(argv[i], kind)) {
+            std::cout << "Unknown program kind " << argv[i] << std::endl;
+            exit(1);
+        }
+        kinds.push_back(kind);
+    }
+    if (kinds.empty()) kinds = { ProgramKind::STRAIGHT, ProgramKind::LOOPS, ProgramKind::LABELS, ProgramKind::COMMENTS };
+
+    bool all_ok = true;
+    std::cout << std::fixed;
+    std::cout << "# bench_suite size=" << size << " seed=" << seed << std::endl;
+    for (ProgramKind kind : kinds) {
+        for (const Benchmark& benchmark : benchmarks) {
+            Measurement m = {};
+            long peak_rss_kb = 0;
+            bool ok = run_isolated(benchmark, kind, size, seed, m, peak_rss_kb);
+            all_ok = all_ok && ok;
+            double seconds = m.seconds > 0 ? m.seconds : 1e-9;
+            std::cout << "bench=" << benchmark.name << " kind=" << program_kind_names[static_cast<int>(kind)]
+                      << " bytes=" << m.bytes << " count=" << m.count << " unit=" << benchmark.unit
+                      << std::setprecision(6) << " seconds=" << m.seconds << std::setprecision(2)
+                      << " mb_per_s=" << m.bytes / seconds / 1e6 << " per_s=" << m.count / seconds
+                      << " allocations=" << m.allocations << " peak_rss_kb=" << peak_rss_kb
+                      << " status=" << (ok ? "ok" : "failed") << std::endl;
+        }
+    }
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include <chrono>
+#include <string>
+#include "../include/optimizer.h"
+#include "../include/trace.h"
+#include "perf_counters.h"
+#include "programs.h"
+
+void print_counter(const char* name, double value) {
+    std::cout << name;
+    if (value < 0) std::cout << "n/a" << std::endl;
+    else std::cout << value << std::endl;
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::stol(argv[1]) : 10000000;
+    long body = argc > 2 ? std::stol(argv[2]) : 0;
+    int level = argc > 3 ? std::stoi(argv[3]) : 0;
+    std::string engine = argc > 4 ? argv[4] : "stack";
+
+    std::string text = loop_program(iterations, body);
+    // The trace engine writes to vm_bench.trace in the working directory; the timed run includes
+    // waiting for the flusher to write it out.
+    Trace trace;
+    if (engine == "trace" && !trace.open("vm_bench.trace").ok()) engine = "stack";
+    auto build = [&]() {
+        SVM* svm = new SVM(optimize(parse_text(text), level));
+        if (engine == "jit" && !svm->enable_jit()) engine = "stack";
+        if (engine == "regvm" && !svm->enable_register_vm()) engine = "stack";
+        if (engine == "profile") svm->profile_execution(true);
+        if (engine == "trace" && !svm->trace_to(&trace)) engine = "stack";
+        return svm;
+    };
+    auto run = [&](SVM* svm) {
+        if (engine == "regvm") svm->execute_registers();
+        else svm->execute();
+    };
+
+    // Dispatch counts come from a separate counted run so the timed run stays uninstrumented.
+    long long dispatched = -1;
+    SVM* svm = build();
+    if (engine != "jit") {
+        svm->count_instructions(true);
+        run(svm);
+        dispatched = svm->instructions_dispatched();
+        delete svm;
+        svm = build();
+    }
+
+    PerfCounters counters;
+    counters.start();
+    if (engine == "trace") trace.open("vm_bench.trace");
+    auto start = std::chrono::steady_clock::now();
+    run(svm);
+    if (engine == "trace") trace.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    counters.stop();
+
+    double executed = loop_program_length(iterations, body);
+    std::cout << "iterations      " << iterations << std::endl;
+    std::cout << "body            " << body << std::endl;
+    std::cout << "level           " << level << std::endl;
+    std::cout << "engine          " << engine << std::endl;
+    std::cout << "dispatched      " << (dispatched < 0 ? "n/a" : std::to_string(dispatched)) << std::endl;
+    std::cout << "executed        " << (long)executed << std::endl;
+    std::cout << "seconds         " << seconds << std::endl;
+    std::cout << "instructions/s  " << (long)(executed / seconds) << std::endl;
+    std::cout << "code_bytes      " << svm->code_bytes() << std::endl;
+    print_counter("cpu_instr/op    ", counters.instructions() < 0 ? -1 : counters.instructions() / executed);
+    print_counter("cache_misses    ", counters.cache_misses());
+    print_counter("l1d_misses      ", counters.l1d_misses());
+    int result = 0;
+    svm->top(result);
+    std::cout << "result          " << result << std::endl;
+
+    delete svm;
+    return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef Syntax_Analysis_ARENA_H
+#define Syntax_Analysis_ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+// Bump allocator for objects that live exactly as long as one compiled program.
+// Nothing is freed individually; release() drops every block at once, and clear() keeps the
+// newest block so a reused arena stops allocating once it has reached its working size.
+class Arena {
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    Block* head;
+    char* cursor;
+    char* limit;
+    size_t block_size;
+
+public:
+    Arena(size_t block_size = 64 * 1024);
+    ~Arena();
+    Arena(Arena&&);
+    Arena& operator=(Arena&&);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+    std::string_view copy(std::string_view);
+    void adopt(Arena&&);
+    void clear();
+    void release();
+
+private:
+    void grow(size_t);
+};
+
+inline void* Arena::allocate(size_t size, size_t align) {
+    size_t padding = (align - reinterpret_cast<size_t>(cursor) % align) % align;
+    if (!cursor || size + padding > static_cast<size_t>(limit - cursor)) {
+        this->grow(size + align);
+        padding = (align - reinterpret_cast<size_t>(cursor) % align) % align;
+    }
+    char* result = cursor + padding;
+    cursor = result + size;
+    return result;
+}
+
+inline std::string_view Arena::copy(std::string_view text) {
+    if (text.empty()) return std::string_view();
+    char* data = static_cast<char*>(this->allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
+
+#endif // Syntax_Analysis_ARENA_H
@@ -0,0 +1,17 @@
+#ifndef Syntax_Analysis_BATCH_H
+#define Syntax_Analysis_BATCH_H
+
+#include "svm.h"
+#include "thread_pool.h"
+
+// One set of initial conditions for a batch run.
+struct BatchInput {
+    int registers[8];
+    std::vector<int> stack;
+};
+
+bool parse_batch_input(const std::string&, BatchInput&);
+Status read_batch_inputs(std::istream&, std::vector<BatchInput>&);
+std::vector<std::string> run_batch(std::shared_ptr<Executable>, const std::vector<BatchInput>&, WorkStealingPool&);
+
+#endif // Syntax_Analysis_BATCH_H
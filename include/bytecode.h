@@ -0,0 +1,87 @@
+#ifndef Syntax_Analysis_BYTECODE_H
+#define Syntax_Analysis_BYTECODE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include "Instruction.h"
+#include "arena.h"
+#include "mapped_file.h"
+
+// Labels-as-values dispatch where the compiler supports it; define SVM_NO_COMPUTED_GOTO to
+// build the portable switch loop instead.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(SVM_NO_COMPUTED_GOTO)
+#define SVM_COMPUTED_GOTO 1
+#endif
+
+// Executable form of a resolved program: one 8-byte word per instruction. Opcodes are
+// Instruction::IType values; the operand is the immediate, register or resolved jump target.
+// Opcodes past IPRINT exist only in bytecode. Every code array ends with one OP_HALT word
+// that is not counted in Program::size(), so falling off the end needs no bounds check.
+// The remaining opcodes are superinstructions produced by the peephole pass; OP_LOAD_JMP*
+// take a second word whose opcode field is the register and whose operand is the constant.
+enum Opcode : uint32_t { OP_HALT = Instruction::IPRINT + 1,
+                         OP_ADDI, OP_SUBI, OP_MULI, OP_DUPSUBI, OP_LOADADD, OP_TEE,
+                         OP_LOAD_JMPEQ, OP_LOAD_JMPGT, OP_LOAD_JMPGE, OP_LOAD_JMPLT, OP_LOAD_JMPLE,
+                         NUM_OPCODES };
+
+struct Op {
+    uint32_t opcode;
+    int32_t operand;
+};
+
+static_assert(sizeof(Op) == 8, "Op must stay packed into 8 bytes");
+
+// Listing name, operand-stack effect, size in code words and number of source instructions
+// each opcode stands for.
+struct OpInfo {
+    const char* name;
+    int pops, pushes;
+    int words, fuses;
+};
+
+constexpr OpInfo op_info[NUM_OPCODES] = {
+    { "push", 0, 1, 1, 1 }, { "pop", 1, 0, 1, 1 }, { "dup", 1, 2, 1, 1 }, { "swap", 2, 2, 1, 1 },
+    { "add", 2, 1, 1, 1 }, { "sub", 2, 1, 1, 1 }, { "mult", 2, 1, 1, 1 }, { "div", 2, 1, 1, 1 },
+    { "goto", 0, 0, 1, 1 }, { "jmpeq", 2, 0, 1, 1 }, { "jmpgt", 2, 0, 1, 1 }, { "jmpge", 2, 0, 1, 1 },
+    { "jmplt", 2, 0, 1, 1 }, { "jmple", 2, 0, 1, 1 }, { "skip", 0, 0, 1, 1 }, { "store", 1, 0, 1, 1 },
+    { "load", 0, 1, 1, 1 }, { "print", 0, 0, 1, 1 }, { "halt", 0, 0, 1, 0 },
+    { "addi", 1, 1, 1, 2 }, { "subi", 1, 1, 1, 2 }, { "multi", 1, 1, 1, 2 }, { "dupsubi", 1, 2, 1, 3 },
+    { "loadadd", 1, 1, 1, 2 }, { "tee", 1, 1, 1, 2 },
+    { "load_jmpeq", 0, 0, 2, 3 }, { "load_jmpgt", 0, 0, 2, 3 }, { "load_jmpge", 0, 0, 2, 3 },
+    { "load_jmplt", 0, 0, 2, 3 }, { "load_jmple", 0, 0, 2, 3 },
+};
+
+// Source-level names kept out of the hot code array. Only label definitions are stored;
+// a jump's label name is the label of its target instruction.
+struct DebugInfo {
+    std::vector<std::pair<int, std::string_view>> labels;
+    Arena strings;
+
+    std::string_view label_at(int) const;
+};
+
+// Code is either owned (`code`) or borrowed from a mapped .svmb image that the program keeps alive.
+struct Program {
+    std::vector<Op> code;
+    DebugInfo debug;
+    std::unique_ptr<MappedFile> image;
+    const Op* image_code;
+    size_t image_size;
+
+    Program();
+    Program(const std::vector<Instruction>&, Arena&&);
+    void assign(const std::vector<Instruction>&, Arena&&);
+
+    const Op* data() const;
+    size_t size() const;
+
+    static bool has_operand(uint32_t);
+    static bool is_jump(uint32_t);
+    static bool uses_register(uint32_t);
+};
+
+inline const Op* Program::data() const { return image ? image_code : code.data(); }
+inline size_t Program::size() const { return image ? image_size : code.size() - 1; }
+
+#endif // Syntax_Analysis_BYTECODE_H
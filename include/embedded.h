@@ -0,0 +1,364 @@
+#ifndef Syntax_Analysis_EMBEDDED_H
+#define Syntax_Analysis_EMBEDDED_H
+
+#include <climits>
+#include <utility>
+#include "bytecode.h"
+#include "lexer.h"
+#include "output.h"
+#include "status.h"
+
+// Programs fixed at build time, such as kernels kept as string literals in a service. The
+// assembler here scans, parses, resolves labels and verifies a program during compilation,
+// with the scanner's own tables and Parser's grammar, and yields a Kernel: the packed code
+// words, ending in OP_HALT as in Program, and the stack depth on entry to each pc. Nothing is
+// left for startup. A text Parser or verify() would reject does not compile; the error names
+// the problem and the line it was found on, as in
+//
+//     In instantiation of 'struct embedded::check<embedded::Problem::EXPECTED_NUMBER, 3>':
+//     error: static assertion failed: SM kernel does not assemble
+//
+// KernelVM<kernel> runs a kernel with one function per basic block, instantiated by template
+// recursion over the code: every word becomes the native code for its opcode, with its operand,
+// stack slot and register as constants. A jump back to the start of its own block loops in
+// place; other jumps go through a table of blocks.
+namespace embedded {
+
+enum class Problem { NONE, INVALID_CHARACTER, UNRECOGNISED_CHARACTER, NO_MATCH, EXPECTED_NUMBER,
+                     NUMBER_OUT_OF_RANGE, EXPECTED_ID, EXPECTED_END_OF_LINE, UNKNOWN_LABEL,
+                     STACK_UNDERFLOW, INVALID_REGISTER, INCONSISTENT_DEPTH };
+
+// A block ends at the latest after this many instructions, which bounds the template recursion.
+const int BLOCK_LIMIT = 256;
+
+// depth[pc] is -1 where pc is unreachable, as in Verification. entry[pc] marks where a block
+// starts: pc 0, the targets of reachable jumps and every BLOCK_LIMIT-th reachable pc.
+template <size_t N>
+struct Kernel {
+    Op code[N + 1];
+    int depth[N + 1];
+    bool entry[N + 1];
+    int max_depth;
+    Problem problem;
+    int line;
+
+    constexpr size_t size() const { return N; }
+};
+
+// Scanner::next_token() and Parser::parseInstruction() over a string, stopping at the first
+// error instead of recording it.
+class Assembler {
+private:
+    std::string_view input;
+    size_t current, start;
+    Token token;
+
+public:
+    Problem problem;
+    size_t problem_at;
+
+    constexpr Assembler(std::string_view input)
+        : input(input), current(0), start(0), token(), problem(Problem::NONE), problem_at(0) {
+        token = this->next_token();
+        if (token.type == Token::ERR) this->fail(Problem::INVALID_CHARACTER);
+    }
+
+    constexpr bool more() const { return token.type != Token::END && problem == Problem::NONE; }
+    constexpr size_t position() const { return start; }
+
+    constexpr int line_of(size_t at) const {
+        int line = 1;
+        for (size_t i = 0; i < at && i < input.size(); i++) line += input[i] == '\n';
+        return line;
+    }
+
+    constexpr bool instruction(Op& op, std::string_view& label, std::string_view& target) {
+        label = target = std::string_view();
+        if (token.type == Token::LABEL) {
+            label = token.lexeme;
+            this->advance();
+        }
+        Instruction::IType itype = Instruction::ISKIP;
+        if (token.type == Token::END || !Token::tokenToIType(token.type, itype)) return this->fail(Problem::NO_MATCH);
+        this->advance();
+
+        op = Op{ static_cast<uint32_t>(itype), 0 };
+        if (itype == Instruction::IPUSH || itype == Instruction::ISTORE || itype == Instruction::ILOAD) {
+            if (token.type != Token::NUM) return this->fail(Problem::EXPECTED_NUMBER);
+            long long value = 0;
+            for (char c : token.lexeme) {
+                value = value * 10 + (c - '0');
+                if (value > INT_MAX) return this->fail(Problem::NUMBER_OUT_OF_RANGE);
+            }
+            op.operand = static_cast<int32_t>(value);
+            this->advance();
+        } else if (itype >= Instruction::IGOTO && itype <= Instruction::IJMPLE) {
+            if (token.type != Token::ID) return this->fail(Problem::EXPECTED_ID);
+            target = token.lexeme;
+            this->advance();
+        }
+        if (token.type != Token::EOL) return this->fail(Problem::EXPECTED_END_OF_LINE);
+        this->advance();
+        return problem == Problem::NONE;
+    }
+
+private:
+    constexpr bool fail(Problem found) {
+        if (problem == Problem::NONE) {
+            problem = found;
+            problem_at = start;
+        }
+        return false;
+    }
+
+    constexpr void advance() {
+        if (token.type == Token::END) return;
+        token = this->next_token();
+        if (token.type == Token::ERR) this->fail(Problem::UNRECOGNISED_CHARACTER);
+    }
+
+    constexpr void skip_blanks() {
+        if (current < input.size() && input[current] == ' ') current++;
+        while (current < input.size()) {
+            char c = input[current];
+            if (c != ' ' && c != '\t' && c != '%') return;
+            while (current < input.size() && (input[current] == ' ' || input[current] == '\t')) current++;
+            if (current >= input.size() || input[current] != '%') return;
+            while (current < input.size() && input[current] != '\n') current++;
+            if (current < input.size()) current++;
+        }
+    }
+
+    constexpr Token next_token() {
+        this->skip_blanks();
+        start = current;
+        if (current >= input.size()) return Token(Token::END);
+
+        uint8_t state = lexer::S_START;
+        while (state < lexer::S_ACCEPT_ID) {
+            unsigned char c = current < input.size() ? static_cast<unsigned char>(input[current]) : '\0';
+            state = lexer::transitions[state][c];
+            current++;
+        }
+        switch (state) {
+            case lexer::S_ACCEPT_ID: {
+                current--;
+                std::string_view lexeme = input.substr(start, current - start);
+                Token::Type token_type = lexer::keyword(lexeme);
+                return token_type != Token::ERR ? Token(token_type) : Token(Token::ID, lexeme);
+            }
+            case lexer::S_ACCEPT_LABEL:
+                return Token(Token::LABEL, input.substr(start, current - 1 - start));
+            case lexer::S_ACCEPT_NUM:
+                current--;
+                return Token(Token::NUM, input.substr(start, current - start));
+            case lexer::S_ACCEPT_EOL:
+                current--;
+                return Token(Token::EOL);
+            case lexer::S_ACCEPT_END:
+                current = input.size();
+                return Token(Token::END);
+            default:
+                return Token(Token::ERR, input.substr(start, 1));
+        }
+    }
+};
+
+// Number of instructions in `source`, or in the part of it before the first error, which
+// assemble() then finds again.
+constexpr size_t count_instructions(std::string_view source) {
+    Assembler assembler(source);
+    Op op{};
+    std::string_view label, target;
+    size_t count = 0;
+    while (assembler.more() && assembler.instruction(op, label, target)) count++;
+    return count;
+}
+
+constexpr bool is_jump(uint32_t opcode) { return opcode >= Instruction::IGOTO && opcode <= Instruction::IJMPLE; }
+
+template <size_t N>
+constexpr Kernel<N> assemble(std::string_view source) {
+    Kernel<N> kernel{};
+    std::string_view labels[N + 1] = {}, targets[N + 1] = {};
+    size_t at[N + 1] = {};
+    Assembler assembler(source);
+    for (size_t n = 0; n <= N && assembler.more(); n++) {
+        at[n] = assembler.position();
+        if (!assembler.instruction(kernel.code[n], labels[n], targets[n])) break;
+    }
+    if (assembler.problem != Problem::NONE) {
+        kernel.problem = assembler.problem;
+        kernel.line = assembler.line_of(assembler.problem_at);
+        return kernel;
+    }
+    kernel.code[N] = Op{ OP_HALT, 0 };
+    at[N] = source.size();
+
+    // The last definition of a repeated label wins, as in Parser::resolveLabels().
+    for (size_t pc = 0; pc < N; pc++) {
+        if (!is_jump(kernel.code[pc].opcode)) continue;
+        size_t k = N;
+        while (k > 0 && labels[k - 1] != targets[pc]) k--;
+        if (k == 0) {
+            kernel.problem = Problem::UNKNOWN_LABEL;
+            kernel.line = assembler.line_of(at[pc]);
+            return kernel;
+        }
+        kernel.code[pc].operand = static_cast<int32_t>(k - 1);
+    }
+
+    // verify(), over the plain opcodes the parser produces.
+    int worklist[N + 1] = {};
+    int pending = 0;
+    for (size_t pc = 0; pc <= N; pc++) kernel.depth[pc] = -1;
+    kernel.depth[0] = 0;
+    worklist[pending++] = 0;
+    while (pending > 0 && kernel.problem == Problem::NONE) {
+        int pc = worklist[--pending];
+        Op op = kernel.code[pc];
+        int depth = kernel.depth[pc];
+        if (depth < op_info[op.opcode].pops) {
+            kernel.problem = Problem::STACK_UNDERFLOW;
+        } else if ((op.opcode == Instruction::ISTORE || op.opcode == Instruction::ILOAD) && op.operand > 7) {
+            kernel.problem = Problem::INVALID_REGISTER;
+        }
+        if (kernel.problem != Problem::NONE) {
+            kernel.line = assembler.line_of(at[pc]);
+            break;
+        }
+
+        int after = depth - op_info[op.opcode].pops + op_info[op.opcode].pushes;
+        if (after > kernel.max_depth) kernel.max_depth = after;
+        int successors[2] = {};
+        int count = 0;
+        if (op.opcode == Instruction::IGOTO) {
+            successors[count++] = op.operand;
+        } else if (op.opcode != OP_HALT) {
+            successors[count++] = pc + 1;
+            if (is_jump(op.opcode)) successors[count++] = op.operand;
+        }
+        for (int i = 0; i < count; i++) {
+            int target = successors[i];
+            if (kernel.depth[target] == -1) {
+                kernel.depth[target] = after;
+                worklist[pending++] = target;
+            } else if (kernel.depth[target] != after) {
+                kernel.problem = Problem::INCONSISTENT_DEPTH;
+                kernel.line = assembler.line_of(at[target]);
+                break;
+            }
+        }
+    }
+
+    for (size_t pc = 0; pc <= N; pc++) {
+        if (kernel.depth[pc] >= 0 && is_jump(kernel.code[pc].opcode)) kernel.entry[kernel.code[pc].operand] = true;
+        if (kernel.depth[pc] >= 0 && pc % BLOCK_LIMIT == 0) kernel.entry[pc] = true;
+    }
+    return kernel;
+}
+
+// Instantiated with a kernel's problem and line so a failed assembly shows both.
+template <Problem Found, int Line>
+struct check {
+    static_assert(Found == Problem::NONE, "SM kernel does not assemble");
+};
+
+} // namespace embedded
+
+// A constexpr Kernel for `source`, a string literal or a constexpr std::string_view at
+// namespace scope; assembled during compilation wherever it is used.
+#define SVM_KERNEL(source) ([] { \
+        constexpr auto kernel = embedded::assemble<embedded::count_instructions(source)>(source); \
+        embedded::check<kernel.problem, kernel.line>(); \
+        return kernel; \
+    }())
+
+// Runs the kernel `K`, a constexpr Kernel with static storage, on its own stack and registers,
+// which start out zeroed and keep their contents after run(), as an SVM's do. Arithmetic wraps,
+// and a division by zero or of INT_MIN by -1 stops the run with the interpreter's RUNTIME_ERROR.
+template <const auto& K>
+class KernelVM {
+private:
+    static constexpr int N = static_cast<int>(K.size());
+    static constexpr int FAILED = -1;
+    typedef int (KernelVM::*Block)(OutputSink&);
+
+    const char* failure = nullptr;
+
+    // Runs from PC to the end of its block and returns the pc to go on from, or FAILED.
+    template <int PC>
+    int block(OutputSink& out) {
+        constexpr Op op = K.code[PC];
+        constexpr int d = K.depth[PC];
+        if constexpr (op.opcode == OP_HALT) {
+            return PC;
+        } else if constexpr (op.opcode == Instruction::IGOTO) {
+            return op.operand;
+        } else {
+            int* s = stack;
+            if constexpr (op.opcode == Instruction::IPUSH) s[d] = op.operand;
+            else if constexpr (op.opcode == Instruction::IDUP) s[d] = s[d - 1];
+            else if constexpr (op.opcode == Instruction::ISWAP) std::swap(s[d - 2], s[d - 1]);
+            else if constexpr (op.opcode == Instruction::IADD) s[d - 2] = static_cast<int>(static_cast<unsigned>(s[d - 2]) + static_cast<unsigned>(s[d - 1]));
+            else if constexpr (op.opcode == Instruction::ISUB) s[d - 2] = static_cast<int>(static_cast<unsigned>(s[d - 2]) - static_cast<unsigned>(s[d - 1]));
+            else if constexpr (op.opcode == Instruction::IMUL) s[d - 2] = static_cast<int>(static_cast<unsigned>(s[d - 2]) * static_cast<unsigned>(s[d - 1]));
+            else if constexpr (op.opcode == Instruction::IDIV) {
+                if (s[d - 1] == 0) { failure = "Division by zero"; return FAILED; }
+                if (s[d - 1] == -1 && s[d - 2] == INT_MIN) { failure = "Integer overflow in division"; return FAILED; }
+                s[d - 2] = s[d - 2] / s[d - 1];
+            }
+            else if constexpr (op.opcode == Instruction::ISTORE) registers[op.operand] = s[d - 1];
+            else if constexpr (op.opcode == Instruction::ILOAD) s[d] = registers[op.operand];
+            else if constexpr (op.opcode == Instruction::IPRINT) out.write_stack(s, d);
+            else if constexpr (op.opcode == Instruction::IJMPEQ) { if (s[d - 2] == s[d - 1]) return op.operand; }
+            else if constexpr (op.opcode == Instruction::IJMPGT) { if (s[d - 2] > s[d - 1]) return op.operand; }
+            else if constexpr (op.opcode == Instruction::IJMPGE) { if (s[d - 2] >= s[d - 1]) return op.operand; }
+            else if constexpr (op.opcode == Instruction::IJMPLT) { if (s[d - 2] < s[d - 1]) return op.operand; }
+            else if constexpr (op.opcode == Instruction::IJMPLE) { if (s[d - 2] <= s[d - 1]) return op.operand; }
+
+            if constexpr (K.entry[PC + 1] && (PC + 1) % embedded::BLOCK_LIMIT == 0) return PC + 1;
+            else return this->block<PC + 1>(out);
+        }
+    }
+
+    // A jump back to the start of the block, as at the end of most loops, stays in native code.
+    template <int PC>
+    int loop(OutputSink& out) {
+        int next = this->block<PC>(out);
+        while (next == PC) next = this->block<PC>(out);
+        return next;
+    }
+
+    template <int PC>
+    static constexpr Block entry() {
+        if constexpr (K.entry[PC]) return &KernelVM::loop<PC>;
+        else return nullptr;
+    }
+
+    template <int... PCs>
+    static constexpr std::array<Block, sizeof...(PCs)> table(std::integer_sequence<int, PCs...>) {
+        return {{ entry<PCs>()... }};
+    }
+
+public:
+    int registers[8];
+    int stack[K.max_depth > 0 ? K.max_depth : 1];
+    int depth;
+
+    KernelVM(): registers(), stack(), depth(0) {}
+
+    Status run(OutputSink& out) {
+        static constexpr std::array<Block, N + 1> blocks = table(std::make_integer_sequence<int, N + 1>());
+        int pc = 0;
+        while (pc != N && pc != FAILED) pc = (this->*blocks[pc])(out);
+        if (pc == FAILED) {
+            depth = 0;
+            return Status(Status::RUNTIME_ERROR, failure);
+        }
+        depth = K.depth[N];
+        return Status();
+    }
+};
+
+#endif // Syntax_Analysis_EMBEDDED_H
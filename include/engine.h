@@ -0,0 +1,25 @@
+#ifndef Syntax_Analysis_ENGINE_H
+#define Syntax_Analysis_ENGINE_H
+
+#include "parser.h"
+
+// Compiles and runs one program after another in-process. The parser, the Executable and the
+// SVM are kept between programs, so once an Engine has seen its largest program, compile() and
+// run() stop allocating. The Executable is only reused while no one else holds it: a caller
+// that keeps executable() alive past the next compile() gets a fresh one instead.
+class Engine {
+private:
+    Scanner scanner;
+    Parser parser;
+    std::shared_ptr<Executable> current;
+    SVM svm;
+
+public:
+    Engine();
+    Status compile(std::string_view source, int level = 0);
+    Status run(std::ostream&, const int* registers = nullptr, const std::vector<int>& stack = {});
+    std::shared_ptr<Executable> executable();
+    SVM& machine();
+};
+
+#endif // Syntax_Analysis_ENGINE_H
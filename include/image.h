@@ -0,0 +1,47 @@
+#ifndef Syntax_Analysis_IMAGE_H
+#define Syntax_Analysis_IMAGE_H
+
+#include "bytecode.h"
+#include "status.h"
+
+// Precompiled program image (.svmb). Little-endian, laid out so that the code section can be
+// executed in place from a read-only mapping:
+//   Header | Op code[code_count + 1] | char pool[pool_size] | pad to 4 | LabelEntry labels[label_count]
+// The extra code word is the OP_HALT sentinel.
+// The constant pool holds the label names referenced by the debug table. The checksum is a
+// 64-bit FNV-1a over every byte after the header.
+namespace image {
+
+const char MAGIC[4] = { 'S', 'V', 'M', 'B' };
+const uint32_t VERSION = 2;
+const uint32_t FLAG_DEBUG = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t code_count;
+    uint32_t pool_size;
+    uint32_t label_count;
+    uint64_t checksum;
+};
+
+struct LabelEntry {
+    int32_t pc;
+    uint32_t offset;
+    uint32_t length;
+};
+
+static_assert(sizeof(Header) == 32, "image header layout changed");
+static_assert(sizeof(LabelEntry) == 12, "image label entry layout changed");
+
+uint64_t checksum(const char*, size_t);
+size_t labels_offset(const Header&);
+bool is_image(std::string_view);
+
+} // namespace image
+
+Status write_image(const Program&, const std::string& path, bool with_debug);
+Status load_image(std::unique_ptr<MappedFile>, Program&);
+
+#endif // Syntax_Analysis_IMAGE_H
@@ -0,0 +1,61 @@
+#ifndef Syntax_Analysis_INCREMENTAL_H
+#define Syntax_Analysis_INCREMENTAL_H
+
+#include "parser.h"
+
+// Front end for a source that is edited while it runs. The compiler keeps the text line by
+// line, the parsed instructions and the line each one starts on, so update() re-scans only the
+// instructions around the edited lines, splices them into the instruction array, and looks up
+// again only the jumps in those lines and the jumps naming a label they define or used to
+// define. The Status it returns and the program it leaves in executable() are the same as
+// Parser::parseProgram() on the whole edited text.
+//
+// On an error the last good program stays in executable() and the failing lines are kept
+// pending, to be re-parsed with the next edit. The Executable is patched in place while no one
+// else holds it; one that is still shared, say by an SVM, is left alone and a fresh one is
+// lowered from the parsed instructions instead, without re-parsing. executable() verifies the
+// patched program, which takes time in its size, so a burst of edits pays for it once. Hot
+// reload is update() followed by SVM::load(executable()).
+class IncrementalCompiler {
+private:
+    typedef std::pair<std::string_view, int> Definition;
+
+    std::vector<std::string> source_lines;
+    std::vector<Instruction> program;
+    std::vector<size_t> first_line;
+    std::vector<size_t> jumps, missing;
+    std::vector<Definition> labels, references;
+    Parser parser;
+    std::shared_ptr<Executable> current;
+    size_t pending_first, pending_last;
+    bool pending, in_sync, verified, truncated;
+    size_t nul_bytes, string_bytes, string_limit;
+
+    // Scratch kept between updates.
+    std::string joined, region;
+    std::vector<std::string> pieces;
+    std::vector<size_t> region_lines, retargeted, still_missing;
+    std::vector<std::string_view> touched;
+    std::vector<Definition> old_labels, new_labels, old_references, new_references, changed;
+    std::vector<Op> words;
+    std::vector<std::pair<int, std::string_view>> entries;
+
+    static void split_into(std::string_view, bool ends_text, std::vector<std::string>&);
+    void splice_lines(size_t line, size_t count, std::string_view, size_t shift_from);
+    Status parse_region(size_t begin, size_t end);
+    Status recompile(size_t first, size_t last);
+    bool resolve(size_t);
+    void patch(size_t first, size_t last, size_t added, bool moved);
+    void lower();
+    void rehome();
+
+public:
+    IncrementalCompiler();
+    Status compile(std::string_view source);
+    Status update(size_t line, size_t count, std::string_view replacement);
+    std::shared_ptr<Executable> executable();
+    std::string source() const;
+    size_t lines() const;
+};
+
+#endif // Syntax_Analysis_INCREMENTAL_H
@@ -0,0 +1,37 @@
+#ifndef Syntax_Analysis_JIT_H
+#define Syntax_Analysis_JIT_H
+
+#include <memory>
+#include "verifier.h"
+#if defined(__x86_64__) && defined(__unix__)
+#define SVM_JIT 1
+#endif
+
+// Native code for one verified program. Every stack depth is known statically, so stack slot k
+// is always [rdi + 4k] and SVM::registers[n] is [rsi + 4n]. Within a basic block the top entries
+// are kept in caller-saved machine registers and only written back at block boundaries. The
+// generated function takes (stack, registers, entry address) and returns the pc it stopped at:
+// either program.size() or an instruction the JIT leaves to the interpreter (print).
+class JitCode {
+private:
+    typedef int (*Function)(int*, int*, const void*);
+
+    uint8_t* memory;
+    size_t length;
+    std::vector<int> entries;
+
+public:
+    JitCode(const std::vector<uint8_t>&, std::vector<int>&&);
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+    ~JitCode();
+
+    bool is_ready() const;
+    bool can_enter(int) const;
+    int run(int*, int*, int) const;
+    size_t code_bytes() const;
+};
+
+std::unique_ptr<JitCode> jit_compile(const Program&, const Verification&);
+
+#endif // Syntax_Analysis_JIT_H
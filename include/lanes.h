@@ -0,0 +1,207 @@
+#ifndef Syntax_Analysis_LANES_H
+#define Syntax_Analysis_LANES_H
+
+#include <climits>
+#include "batch.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+#define SVM_LANES 16
+#else
+#define SVM_LANES 8
+#endif
+
+// One int per program instance: a single AVX-512 register, an AVX2 register, a pair of SSE2
+// registers, or a plain array the compiler may vectorize on other targets. LaneMask is the
+// matching per-lane write mask, built from a bitmask with bit i for lane i.
+#if defined(__AVX512F__)
+struct Lanes { __m512i v; };
+typedef __mmask16 LaneMask;
+#elif defined(__AVX2__)
+struct Lanes { __m256i v; };
+typedef __m256i LaneMask;
+#elif defined(__SSE2__)
+struct Lanes { __m128i lo, hi; };
+struct LaneMask { __m128i lo, hi; };
+#else
+struct Lanes { int v[SVM_LANES]; };
+typedef unsigned LaneMask;
+#endif
+
+namespace lanes {
+
+const unsigned ALL = (1u << SVM_LANES) - 1;
+
+#if defined(__AVX512F__)
+inline Lanes broadcast(int x) { return { _mm512_set1_epi32(x) }; }
+inline Lanes load(const int* p) { return { _mm512_loadu_si512(p) }; }
+inline void store(int* p, Lanes a) { _mm512_storeu_si512(p, a.v); }
+inline Lanes add(Lanes a, Lanes b) { return { _mm512_add_epi32(a.v, b.v) }; }
+inline Lanes sub(Lanes a, Lanes b) { return { _mm512_sub_epi32(a.v, b.v) }; }
+inline Lanes mul(Lanes a, Lanes b) { return { _mm512_mullo_epi32(a.v, b.v) }; }
+inline unsigned eq(Lanes a, Lanes b) { return _mm512_cmpeq_epi32_mask(a.v, b.v); }
+inline unsigned gt(Lanes a, Lanes b) { return _mm512_cmpgt_epi32_mask(a.v, b.v); }
+inline LaneMask mask(unsigned bits) { return bits; }
+inline Lanes select(LaneMask m, Lanes a, Lanes b) { return { _mm512_mask_blend_epi32(m, b.v, a.v) }; }
+#elif defined(__AVX2__)
+inline Lanes broadcast(int x) { return { _mm256_set1_epi32(x) }; }
+inline Lanes load(const int* p) { return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) }; }
+inline void store(int* p, Lanes a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a.v); }
+inline Lanes add(Lanes a, Lanes b) { return { _mm256_add_epi32(a.v, b.v) }; }
+inline Lanes sub(Lanes a, Lanes b) { return { _mm256_sub_epi32(a.v, b.v) }; }
+inline Lanes mul(Lanes a, Lanes b) { return { _mm256_mullo_epi32(a.v, b.v) }; }
+inline unsigned eq(Lanes a, Lanes b) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v)));
+}
+inline unsigned gt(Lanes a, Lanes b) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a.v, b.v)));
+}
+inline LaneMask mask(unsigned bits) {
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lane_bits), lane_bits);
+}
+inline Lanes select(LaneMask m, Lanes a, Lanes b) { return { _mm256_blendv_epi8(b.v, a.v, m) }; }
+#elif defined(__SSE2__)
+inline __m128i mul4(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+    return _mm_mullo_epi32(a, b);
+#else
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+inline unsigned bits4(__m128i compare) { return _mm_movemask_ps(_mm_castsi128_ps(compare)); }
+inline __m128i select4(__m128i m, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+inline Lanes broadcast(int x) { return { _mm_set1_epi32(x), _mm_set1_epi32(x) }; }
+inline Lanes load(const int* p) {
+    return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+             _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4)) };
+}
+inline void store(int* p, Lanes a) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a.lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 4), a.hi);
+}
+inline Lanes add(Lanes a, Lanes b) { return { _mm_add_epi32(a.lo, b.lo), _mm_add_epi32(a.hi, b.hi) }; }
+inline Lanes sub(Lanes a, Lanes b) { return { _mm_sub_epi32(a.lo, b.lo), _mm_sub_epi32(a.hi, b.hi) }; }
+inline Lanes mul(Lanes a, Lanes b) { return { mul4(a.lo, b.lo), mul4(a.hi, b.hi) }; }
+inline unsigned eq(Lanes a, Lanes b) {
+    return bits4(_mm_cmpeq_epi32(a.lo, b.lo)) | bits4(_mm_cmpeq_epi32(a.hi, b.hi)) << 4;
+}
+inline unsigned gt(Lanes a, Lanes b) {
+    return bits4(_mm_cmpgt_epi32(a.lo, b.lo)) | bits4(_mm_cmpgt_epi32(a.hi, b.hi)) << 4;
+}
+inline LaneMask mask(unsigned bits) {
+    const __m128i low = _mm_setr_epi32(1, 2, 4, 8), high = _mm_setr_epi32(16, 32, 64, 128);
+    __m128i all = _mm_set1_epi32(bits);
+    return { _mm_cmpeq_epi32(_mm_and_si128(all, low), low), _mm_cmpeq_epi32(_mm_and_si128(all, high), high) };
+}
+inline Lanes select(LaneMask m, Lanes a, Lanes b) { return { select4(m.lo, a.lo, b.lo), select4(m.hi, a.hi, b.hi) }; }
+#else
+inline Lanes broadcast(int x) {
+    Lanes r;
+    for (int i = 0; i < SVM_LANES; i++) r.v[i] = x;
+    return r;
+}
+inline Lanes load(const int* p) {
+    Lanes r;
+    for (int i = 0; i < SVM_LANES; i++) r.v[i] = p[i];
+    return r;
+}
+inline void store(int* p, Lanes a) {
+    for (int i = 0; i < SVM_LANES; i++) p[i] = a.v[i];
+}
+inline Lanes add(Lanes a, Lanes b) {
+    for (int i = 0; i < SVM_LANES; i++) a.v[i] = (int)((unsigned)a.v[i] + (unsigned)b.v[i]);
+    return a;
+}
+inline Lanes sub(Lanes a, Lanes b) {
+    for (int i = 0; i < SVM_LANES; i++) a.v[i] = (int)((unsigned)a.v[i] - (unsigned)b.v[i]);
+    return a;
+}
+inline Lanes mul(Lanes a, Lanes b) {
+    for (int i = 0; i < SVM_LANES; i++) a.v[i] = (int)((unsigned)a.v[i] * (unsigned)b.v[i]);
+    return a;
+}
+inline unsigned eq(Lanes a, Lanes b) {
+    unsigned bits = 0;
+    for (int i = 0; i < SVM_LANES; i++) bits |= (unsigned)(a.v[i] == b.v[i]) << i;
+    return bits;
+}
+inline unsigned gt(Lanes a, Lanes b) {
+    unsigned bits = 0;
+    for (int i = 0; i < SVM_LANES; i++) bits |= (unsigned)(a.v[i] > b.v[i]) << i;
+    return bits;
+}
+inline LaneMask mask(unsigned bits) { return bits; }
+inline Lanes select(LaneMask m, Lanes a, Lanes b) {
+    for (int i = 0; i < SVM_LANES; i++) if (!(m >> i & 1)) a.v[i] = b.v[i];
+    return a;
+}
+#endif
+
+// Bit i set where the comparison `a <op> b` holds in lane i, for the five conditional jumps.
+inline unsigned compare(uint32_t opcode, Lanes a, Lanes b) {
+    switch (opcode) {
+        case Instruction::IJMPEQ: case OP_LOAD_JMPEQ: return eq(a, b);
+        case Instruction::IJMPGT: case OP_LOAD_JMPGT: return gt(a, b);
+        case Instruction::IJMPGE: case OP_LOAD_JMPGE: return ~gt(b, a) & ALL;
+        case Instruction::IJMPLT: case OP_LOAD_JMPLT: return gt(b, a);
+        default: return ~gt(a, b) & ALL;
+    }
+}
+
+} // namespace lanes
+
+// Runs up to SVM_LANES instances of one verified program in lockstep. Every stack slot and
+// register holds one value per lane, and each instruction is one vector operation applied under
+// the mask of the lanes currently executing. A conditional jump whose lanes disagree splits them
+// into groups; the group with the lowest pc runs first and absorbs any waiting group it meets
+// at the same pc, so lanes that take different sides of an if re-converge at the join point and
+// lanes that leave a loop early wait for the rest at its exit.
+class LaneVM {
+public:
+    static const int LANES = SVM_LANES;
+
+private:
+    struct Group {
+        int pc;
+        unsigned lanes;
+    };
+
+    std::shared_ptr<Executable> executable;
+    std::vector<Lanes> slots;
+    Lanes registers[8];
+    Group waiting[LANES];
+    int num_waiting, barrier;
+    unsigned active;
+    LaneMask active_mask;
+    long long vector_instructions, lane_instructions;
+
+    void activate(unsigned);
+    void schedule(int, unsigned);
+    int pick();
+    void merge();
+    int branch(unsigned, int, int);
+    bool divide(Lanes*);
+    void print(unsigned, int, const BatchInput*, std::string*);
+    void run_scalar(const BatchInput*, int, std::string*);
+
+public:
+    LaneVM(std::shared_ptr<Executable>);
+    void run(const BatchInput*, int, std::string*);
+    long long instructions_dispatched();
+    long long lane_instructions_executed();
+};
+
+std::vector<std::string> run_batch_lanes(std::shared_ptr<Executable>, const std::vector<BatchInput>&, WorkStealingPool&,
+                                         long long* executed = nullptr);
+
+#endif // Syntax_Analysis_LANES_H
@@ -0,0 +1,108 @@
+#ifndef Syntax_Analysis_LEXER_H
+#define Syntax_Analysis_LEXER_H
+
+#include <array>
+#include <cstdint>
+#include "token.h"
+
+// Tables of the scanner's DFA, built at compile time and shared by Scanner and the constexpr
+// assembler in embedded.h.
+namespace lexer {
+
+enum CharClass : uint8_t { C_OTHER=0, C_ALPHA, C_DIGIT, C_UNDERSCORE, C_NEWLINE, C_COLON, C_END, NUM_CLASSES };
+
+enum State : uint8_t { S_START=0, S_ID, S_NUM, S_EOL,
+                       S_ACCEPT_ID, S_ACCEPT_LABEL, S_ACCEPT_NUM, S_ACCEPT_EOL, S_ACCEPT_END, S_ERR, NUM_STATES };
+
+constexpr std::array<uint8_t, 256> make_char_classes() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 'a'; c <= 'z'; c++) table[c] = C_ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++) table[c] = C_ALPHA;
+    for (int c = '0'; c <= '9'; c++) table[c] = C_DIGIT;
+    table['_'] = C_UNDERSCORE;
+    table['\n'] = C_NEWLINE;
+    table[':'] = C_COLON;
+    table['\0'] = C_END;
+    return table;
+}
+
+constexpr std::array<std::array<uint8_t, NUM_CLASSES>, NUM_STATES> make_class_transitions() {
+    std::array<std::array<uint8_t, NUM_CLASSES>, NUM_STATES> table{};
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        table[S_START][c] = S_ERR;
+        table[S_ID][c] = S_ACCEPT_ID;
+        table[S_NUM][c] = S_ACCEPT_NUM;
+        table[S_EOL][c] = S_ACCEPT_EOL;
+    }
+    table[S_START][C_ALPHA] = S_ID;
+    table[S_START][C_DIGIT] = S_NUM;
+    table[S_START][C_NEWLINE] = S_EOL;
+    table[S_START][C_END] = S_ACCEPT_END;
+    table[S_ID][C_ALPHA] = S_ID;
+    table[S_ID][C_DIGIT] = S_ID;
+    table[S_ID][C_UNDERSCORE] = S_ID;
+    table[S_ID][C_COLON] = S_ACCEPT_LABEL;
+    table[S_NUM][C_DIGIT] = S_NUM;
+    table[S_EOL][C_NEWLINE] = S_EOL;
+    return table;
+}
+
+// The class table is folded into the transition table so each input byte costs a single lookup.
+constexpr std::array<std::array<uint8_t, 256>, S_ACCEPT_ID> make_transitions() {
+    std::array<uint8_t, 256> classes = make_char_classes();
+    std::array<std::array<uint8_t, NUM_CLASSES>, NUM_STATES> by_class = make_class_transitions();
+    std::array<std::array<uint8_t, 256>, S_ACCEPT_ID> table{};
+    for (int state = 0; state < S_ACCEPT_ID; state++)
+        for (int c = 0; c < 256; c++) table[state][c] = by_class[state][classes[c]];
+    return table;
+}
+
+inline constexpr std::array<std::array<uint8_t, 256>, S_ACCEPT_ID> transitions = make_transitions();
+
+// The keyword a lexeme spells, or ERR for an identifier.
+constexpr Token::Type keyword(std::string_view lexeme) {
+    switch (lexeme.size()) {
+        case 3:
+            switch (lexeme[0]) {
+                case 'a': if (lexeme == "add") return Token::ADD; break;
+                case 'd':
+                    if (lexeme == "dup") return Token::DUP;
+                    if (lexeme == "div") return Token::DIV;
+                    break;
+                case 'm': if (lexeme == "mul") return Token::MUL; break;
+                case 'p': if (lexeme == "pop") return Token::POP; break;
+                case 's': if (lexeme == "sub") return Token::SUB; break;
+            }
+            break;
+        case 4:
+            switch (lexeme[0]) {
+                case 'g': if (lexeme == "goto") return Token::GOTO; break;
+                case 'l': if (lexeme == "load") return Token::LOAD; break;
+                case 'p': if (lexeme == "push") return Token::PUSH; break;
+                case 's':
+                    if (lexeme == "skip") return Token::SKIP;
+                    if (lexeme == "swap") return Token::SWAP;
+                    break;
+            }
+            break;
+        case 5:
+            switch (lexeme[0]) {
+                case 'j':
+                    if (lexeme[1] != 'm' || lexeme[2] != 'p') break;
+                    if (lexeme[3] == 'e' && lexeme[4] == 'q') return Token::JMPEQ;
+                    if (lexeme[3] == 'g' && lexeme[4] == 't') return Token::JMPGT;
+                    if (lexeme[3] == 'g' && lexeme[4] == 'e') return Token::JMPGE;
+                    if (lexeme[3] == 'l' && lexeme[4] == 't') return Token::JMPLT;
+                    if (lexeme[3] == 'l' && lexeme[4] == 'e') return Token::JMPLE;
+                    break;
+                case 'p': if (lexeme == "print") return Token::PRINT; break;
+                case 's': if (lexeme == "store") return Token::STORE; break;
+            }
+            break;
+    }
+    return Token::ERR;
+}
+
+} // namespace lexer
+
+#endif // Syntax_Analysis_LEXER_H
@@ -0,0 +1,24 @@
+#ifndef Syntax_Analysis_MAPPED_FILE_H
+#define Syntax_Analysis_MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+    bool opened;
+
+public:
+    MappedFile(const std::string&);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const;
+    std::string_view view() const;
+    void close();
+};
+
+#endif // Syntax_Analysis_MAPPED_FILE_H
@@ -0,0 +1,15 @@
+#ifndef Syntax_Analysis_OPTIMIZER_H
+#define Syntax_Analysis_OPTIMIZER_H
+
+#include "verifier.h"
+
+struct OptimizeStats {
+    int folded, dead_blocks, fused;
+    size_t before, after;
+};
+
+Program fold_constants(Program&&, OptimizeStats* stats = nullptr);
+Program peephole(Program&&, OptimizeStats* stats = nullptr);
+Program optimize(Program&&, int level, OptimizeStats* stats = nullptr);
+
+#endif // Syntax_Analysis_OPTIMIZER_H
@@ -0,0 +1,44 @@
+#ifndef Syntax_Analysis_OUTPUT_H
+#define Syntax_Analysis_OUTPUT_H
+
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+// Destination of the `print` instruction. Output collects in a buffer that is handed to the
+// stream only once `threshold` bytes have piled up, by flush(), or when the sink is destroyed;
+// the stream itself is never flushed. The buffer grows on demand up to the threshold and is then
+// reused, so a warm sink does not allocate.
+//
+// TEXT writes what print_stack() always has, "stack [ <top> ... <bottom> ]\n". BINARY writes one
+// record per print in host byte order: an int32 depth followed by that many int32 values, top
+// first.
+class OutputSink {
+public:
+    enum Format { TEXT, BINARY };
+
+private:
+    std::ostream* stream;
+    std::unique_ptr<char[]> buffer;
+    size_t used, capacity, threshold;
+    Format format;
+
+    char* reserve(size_t);
+
+public:
+    OutputSink(std::ostream&, size_t threshold = 64 * 1024, Format = TEXT);
+    ~OutputSink();
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void set_stream(std::ostream&);
+    void set_threshold(size_t);
+    void set_format(Format);
+    std::ostream& target();
+
+    void write_stack(const int* bottom, int depth);
+    void write(std::string_view);
+    void flush();
+};
+
+#endif // Syntax_Analysis_OUTPUT_H
@@ -0,0 +1,49 @@
+#ifndef Syntax_Analysis_PARALLEL_PARSER_H
+#define Syntax_Analysis_PARALLEL_PARSER_H
+
+#include "parser.h"
+#include "thread_pool.h"
+
+// Front end for large in-memory sources. The text is cut at line boundaries into chunks that
+// are scanned and parsed concurrently, each into its own instruction buffer and arena; the
+// chunks are then concatenated and every jump resolved against one global label table. The
+// result, including which error is returned, is the same as Parser::parseProgram() on the
+// whole text. A label defined more than once, in one chunk or across chunks, resolves to its
+// last definition there too; duplicates() names every such label.
+class ParallelParser {
+private:
+    typedef std::pair<std::string_view, int> Definition;
+
+    struct Chunk {
+        std::string_view text;
+        std::vector<Instruction> program;
+        std::vector<size_t> jumps;
+        std::vector<Definition> labels;
+        Arena arena;
+        Status failure;
+        std::string_view missing;
+        bool truncated;
+        size_t offset, label_offset;
+    };
+
+    std::string_view source;
+    WorkStealingPool& pool;
+    size_t chunk_size;
+    std::vector<Chunk> chunks;
+    std::vector<std::string> duplicated;
+
+    bool ends_eol(size_t);
+    static bool ends_input(std::string_view);
+    void split();
+    void parse_chunk(size_t);
+    std::vector<Definition> merge_labels();
+    void lower_chunk(size_t, const std::vector<Definition>&, Program&);
+
+public:
+    ParallelParser(std::string_view, WorkStealingPool&, size_t chunk_size = 1 << 20);
+    Status parseProgram(Program&);
+    size_t num_chunks();
+    const std::vector<std::string>& duplicates();
+};
+
+#endif // Syntax_Analysis_PARALLEL_PARSER_H
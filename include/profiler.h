@@ -0,0 +1,31 @@
+#ifndef Syntax_Analysis_PROFILER_H
+#define Syntax_Analysis_PROFILER_H
+
+#include <ostream>
+#include "bytecode.h"
+
+// Counters filled in by SVM::run<PROFILED>: how often each pc was dispatched, how often each
+// jump there was taken, and the deepest the operand stack got. Everything else in the report
+// (per-opcode totals, not-taken counts, loops) is derived from these after the run.
+struct Profile {
+    std::vector<long long> executed, taken;
+    int peak_depth;
+
+    Profile(size_t size);
+    long long taken_at(const Program&, int) const;
+};
+
+// A backward jump and the code it closes over, [head, back_edge].
+struct HotLoop {
+    int head, back_edge;
+    long long iterations, instructions;
+};
+
+std::string listing_line(const Program&, int pc);
+std::vector<HotLoop> hot_loops(const Program&, const Profile&);
+std::vector<long long> opcode_counts(const Program&, const Profile&);
+void print_profile(const Program&, const Profile&, std::ostream&, int top = 5);
+void write_json_string(std::string_view, std::ostream&);
+void write_profile_json(const Program&, const Profile&, std::string_view name, std::ostream&);
+
+#endif // Syntax_Analysis_PROFILER_H
@@ -0,0 +1,45 @@
+#ifndef Syntax_Analysis_PROGRAM_CACHE_H
+#define Syntax_Analysis_PROGRAM_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "svm.h"
+
+struct CacheStats {
+    unsigned long long hits, misses, evictions;
+    size_t entries, bytes;
+};
+
+// Least-recently-used cache of compiled programs, keyed by a hash of the source text and the
+// optimization level. A hit hands back the shared, read-only Executable without scanning,
+// parsing or resolving labels; the stored source is compared on every hit, so a hash collision
+// is a miss rather than the wrong program. Entries are evicted oldest first once either limit
+// is exceeded. Safe to use from any number of threads; compilation happens outside the lock.
+class ProgramCache {
+private:
+    struct Entry {
+        uint64_t key;
+        int level;
+        std::string source;
+        std::shared_ptr<Executable> executable;
+        size_t bytes;
+    };
+
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    size_t max_entries, max_bytes, bytes;
+    unsigned long long hits, misses, evictions;
+    std::mutex lock;
+
+    static uint64_t key_of(std::string_view, int);
+    static std::shared_ptr<Executable> compile(std::string_view, int, Status&);
+    void evict();
+
+public:
+    ProgramCache(size_t max_entries, size_t max_bytes);
+    Status get(std::string_view source, int level, std::shared_ptr<Executable>& out);
+    CacheStats stats();
+};
+
+#endif // Syntax_Analysis_PROGRAM_CACHE_H
@@ -0,0 +1,43 @@
+#ifndef Syntax_Analysis_REGVM_H
+#define Syntax_Analysis_REGVM_H
+
+#include "output.h"
+#include "verifier.h"
+
+// Three-address form of a verified program. The register file holds the 8 SVM registers
+// (r0-r7), then one register per operand stack slot (s0..), then per-block temporaries (t0..).
+// Slot k is the same register in every block, which is what unifies stack values at joins.
+enum RegOpcode : uint16_t { R_HALT = 0, R_MOV, R_MOVI, R_ADD, R_SUB, R_MUL, R_DIV, R_ADDI, R_SUBI, R_MULI, R_DIVI,
+                            R_JMP, R_JEQ, R_JGT, R_JGE, R_JLT, R_JLE, R_JEQI, R_JGTI, R_JGEI, R_JLTI, R_JLEI,
+                            R_PRINT, NUM_REG_OPCODES };
+
+struct RegOp {
+    uint16_t opcode, dst, a, b;
+    int32_t imm, target;
+};
+
+static_assert(sizeof(RegOp) == 16, "RegOp must stay 16 bytes");
+
+// Register-machine engine for verified programs. Superinstructions are split back into their
+// base instructions before translation. Unverified programs report !ok() and the caller keeps
+// the stack interpreter.
+class RegisterVM {
+private:
+    std::vector<RegOp> code;
+    std::vector<std::pair<int, std::string_view>> labels;
+    int num_registers, final_depth, temp_base;
+    bool translated;
+
+public:
+    RegisterVM(const Program&, const Verification&);
+    bool ok() const;
+    template<bool Counted>
+    long long run(int*, std::vector<int>&, std::vector<int>&, int&, OutputSink&, const char*& error) const;
+    void print() const;
+    size_t size() const;
+
+private:
+    static void print_register(int, int);
+};
+
+#endif // Syntax_Analysis_REGVM_H
@@ -0,0 +1,59 @@
+#ifndef Syntax_Analysis_SCHEDULER_H
+#define Syntax_Analysis_SCHEDULER_H
+
+#include <chrono>
+#include <sstream>
+#include "batch.h"
+
+// Per-instance limits. Zero means unlimited. The instruction limit is enforced with the same
+// granularity as SVM::resume()'s budget; the deadline is checked between slices, so it can be
+// overrun by one slice.
+struct TaskLimits {
+    long long max_instructions;
+    double timeout_seconds;
+};
+
+// Outcome of one instance: its output (prints followed by the final stack, or the error that
+// stopped it, as run_batch() formats them), the instructions charged and the slices it ran in.
+struct TaskResult {
+    Status status;
+    std::string output;
+    long long instructions;
+    int slices;
+};
+
+// Multiplexes many program instances over a few threads. Each instance is an SVM plus its output
+// buffer; a worker takes the instance at the front of the run queue, resumes it for one slice of
+// `quantum` instructions and, unless it finished, puts it at the back. A print does not end the
+// slice: the instance resumes with what is left of the quantum. An instance only costs its SVM
+// and its output, so thousands can be in flight at once. Deadlines count from submit().
+class Scheduler {
+private:
+    // `out` is declared first so that it outlives `svm`, whose sink flushes into it on destruction.
+    struct Task {
+        std::ostringstream out;
+        SVM svm;
+        TaskLimits limits;
+        std::chrono::steady_clock::time_point deadline;
+        TaskResult result;
+        bool finished;
+
+        Task(std::shared_ptr<Executable>, const BatchInput&, const TaskLimits&);
+    };
+
+    std::vector<std::unique_ptr<Task>> tasks;
+    long long quantum;
+    int threads;
+
+    bool run_slice(Task&);
+    void finish(Task&, const Status&);
+
+public:
+    Scheduler(int threads, long long quantum = 10000);
+    size_t submit(std::shared_ptr<Executable>, const BatchInput&, const TaskLimits& = TaskLimits());
+    void run();
+    const TaskResult& result(size_t) const;
+    size_t size() const;
+};
+
+#endif // Syntax_Analysis_SCHEDULER_H
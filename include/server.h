@@ -0,0 +1,52 @@
+#ifndef Syntax_Analysis_SERVER_H
+#define Syntax_Analysis_SERVER_H
+
+#include <atomic>
+#include "program_cache.h"
+#include "scheduler.h"
+
+// Local compile-and-run daemon on a Unix domain socket. A connection carries any number of
+// requests, answered in order:
+//
+//   RUN <level> <length>\n<source: length bytes><input>\n
+//   STATS\n
+//
+// <level> is the -O level, 0 to 2, and <input> is one line in the format of parse_batch_input().
+// Every response is
+//
+//   <status> <length>\n<payload: length bytes>
+//
+// where <status> is a Status::code_name(). A RUN payload is the program's output, prints followed
+// by the final stack, or the compile error; a runtime error ends the output with "error: <msg>"
+// and has status runtime_error. A STATS payload is one line of key=value counters.
+//
+// Each worker thread accepts and serves one connection at a time with its own SVM, which is
+// loaded with the cached Executable for every request. A request runs in slices of SLICE
+// instructions under `limits`, like a Scheduler task, so a program that does not halt fails with
+// a runtime_error instead of holding its worker, and stop() is noticed between slices.
+class Server {
+private:
+    static const long long SLICE = 1000000;
+
+    ProgramCache& cache;
+    int threads;
+    TaskLimits limits;
+    int listener;
+    std::string path;
+    std::atomic<bool> stopping;
+    std::atomic<unsigned long long> requests;
+
+    void worker();
+    void serve_connection(int, SVM&);
+    Status run_request(SVM&);
+    std::string stats_line();
+
+public:
+    Server(ProgramCache&, int threads, const TaskLimits& = TaskLimits());
+    ~Server();
+    Status listen(const std::string& path);
+    void serve();
+    void stop();
+};
+
+#endif // Syntax_Analysis_SERVER_H
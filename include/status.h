@@ -0,0 +1,21 @@
+#ifndef Syntax_Analysis_STATUS_H
+#define Syntax_Analysis_STATUS_H
+
+#include <string>
+
+// Outcome of a library call that can fail on bad input: parsing, label resolution, loading an
+// image, reading batch inputs or running a program. Nothing in the library exits the process;
+// `message` is the text the command-line tool prints for the error.
+struct Status {
+    enum Code { OK = 0, SYNTAX_ERROR, UNKNOWN_LABEL, INVALID_IMAGE, INVALID_INPUT, IO_ERROR, RUNTIME_ERROR };
+
+    Code code;
+    std::string message;
+
+    Status();
+    Status(Code, std::string);
+    bool ok() const;
+    static const char* code_name(Code);
+};
+
+#endif // Syntax_Analysis_STATUS_H
@@ -0,0 +1,101 @@
+#ifndef Syntax_Analysis_SVM_H
+#define Syntax_Analysis_SVM_H
+
+#include "jit.h"
+#include "output.h"
+#include "profiler.h"
+#include "regvm.h"
+#include "status.h"
+#include "trace.h"
+
+// Everything about a loaded program that stays fixed while it runs: the bytecode, its
+// verification and the optional native and register-machine translations. Enable the
+// translations first; after that an Executable is read-only and can be shared by any number of
+// SVMs on any number of threads.
+class Executable {
+public:
+    Program program;
+    Verification verification;
+    std::unique_ptr<JitCode> jit;
+    std::unique_ptr<RegisterVM> register_vm;
+
+    Executable(Program&&);
+    void reload();
+    bool enable_jit();
+    bool enable_register_vm();
+};
+
+// The mutable state of one run. `entry_depth` is the depth of the caller-supplied initial stack,
+// which a verified program never reaches below. `budget` is what is left of the instruction
+// budget during a resume().
+struct ExecutionContext {
+    int registers[8];
+    std::vector<int> stack;
+    int depth, entry_depth;
+    int pc;
+    long long budget;
+    long long dispatched, source_executed;
+    std::vector<int> register_file;
+    OutputSink* out;
+};
+
+// Operand stack lives in one contiguous int array. Programs that pass verify() run on an array
+// sized to their maximum depth with no underflow, overflow or register checks; anything else
+// runs the same handlers in checked mode, growing the array on demand. A failed check stops the
+// run and execute() returns it as a RUNTIME_ERROR. Division by zero and INT_MIN / -1 are checked
+// in every mode and fail the same way instead of trapping.
+class SVM {
+public:
+    // Compile-time variants of the dispatch loop.
+    enum Mode { CHECKED = 1, COUNTED = 2, SINGLE_STEP = 4, PROFILED = 8, BUDGETED = 16, TRACED = 32 };
+    // Why resume() returned.
+    enum Stop { HALTED, FAILED, OUT_OF_BUDGET, PRINTED };
+
+private:
+    std::shared_ptr<Executable> executable;
+    ExecutionContext context;
+    bool counting;
+    std::unique_ptr<Profile> profile;
+    Trace* tracer;
+    OutputSink output;
+    Status failure;
+    Stop stopped;
+
+private:
+    void fail(const std::string&);
+    void grow_stack();
+    Status finish();
+    template<int Mode> void run();
+
+public:
+    SVM(Program&&);
+    SVM(std::shared_ptr<Executable>);
+    void load(std::shared_ptr<Executable>);
+    void reset(const int*, const std::vector<int>&);
+    void set_output(std::ostream&);
+    void set_output(OutputSink&);
+    void flush_output();
+    Status execute();
+    Status execute_registers();
+    Stop resume(long long& budget);
+    bool step();
+    const Status& status();
+    bool enable_jit();
+    bool enable_register_vm();
+    void print_registers();
+    bool verified();
+    int max_depth();
+    void count_instructions(bool);
+    void profile_execution(bool);
+    const Profile* execution_profile();
+    bool trace_to(Trace*);
+    const Program& program();
+    long long instructions_dispatched();
+    long long source_instructions_executed();
+    void print_stack();
+    void print();
+    bool top(int&);
+    size_t code_bytes();
+};
+
+#endif // Syntax_Analysis_SVM_H
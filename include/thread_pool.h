@@ -0,0 +1,45 @@
+#ifndef Syntax_Analysis_THREAD_POOL_H
+#define Syntax_Analysis_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. parallel_for() cuts the index range into
+// chunks and deals each worker a contiguous share; a worker drains its own queue from the back
+// and, once empty, steals chunks from the front of the others, so uneven work (long-running
+// inputs) still spreads across all threads.
+class WorkStealingPool {
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::pair<size_t, size_t>> chunks;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::mutex lock;
+    std::condition_variable wake, finished;
+    const std::function<void(size_t, int)>* job;
+    unsigned long generation;
+    int busy;
+    bool stopping;
+
+    void worker(int);
+    bool take(int, std::pair<size_t, size_t>&);
+
+public:
+    explicit WorkStealingPool(int threads);
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    ~WorkStealingPool();
+
+    int size() const;
+    void parallel_for(size_t count, const std::function<void(size_t, int)>& job);
+};
+
+#endif // Syntax_Analysis_THREAD_POOL_H
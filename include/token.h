@@ -1,7 +1,8 @@
 #ifndef Syntax_Analysis_TOKEN_H
 #define Syntax_Analysis_TOKEN_H
 
-#include "instruction.h"
+#include <string_view>
+#include "Instruction.h"
 
 struct Token {
     enum Type { ID=0, LABEL, NUM, EOL, ERR, END, 
@@ -11,32 +12,24 @@ struct Token {
     static const char* token_names[24];
 
     Type type;
-    std::string lexeme;
+    std::string_view lexeme;
 
-    Token(Type);
-    Token(Type, char);
-    Token(Type, const std::string&);
-    static Instruction::IType tokenToIType(Type token_type);
+    constexpr Token();
+    constexpr Token(Type);
+    constexpr Token(Type, std::string_view);
+    static constexpr bool tokenToIType(Type token_type, Instruction::IType& itype);
 };
 
-const char* Token::token_names[24] = { "ID", "LABEL", "NUM", "EOL", "ERR", "END", 
-                                       "PUSH", "JMEPEQ", "JMPGT", "JMPGE", "JMPLT", "JMPLE", 
-                                       "GOTO", "SKIP", "POP", "DUP", "SWAP", 
-                                       "ADD", "SUB", "MUL", "DIV", "STORE", "LOAD", "PRINT" };
+std::ostream& operator<<(std::ostream&, const Token&);
 
-Token::Token(Type t): type(t) { lexeme = ""; }
-Token::Token(Type t, char c): type(t) { lexeme = c; }
-Token::Token(Type t, const std::string& source): type(t) { lexeme = source; }
+static_assert(std::is_trivially_copyable<Token>::value, "Token must stay a plain value type");
 
-std::ostream& operator<<(std::ostream& stream, const Token& token) {
-    stream << Token::token_names[token.type];
-    if (!token.lexeme.empty()) stream << "(" << token.lexeme << ")";
-    
-    return stream;
-}
+constexpr Token::Token(): type(END) {}
+constexpr Token::Token(Type t): type(t) {}
+constexpr Token::Token(Type t, std::string_view source): type(t), lexeme(source) {}
 
-Instruction::IType Token::tokenToIType(Token::Type token_type) {
-    Instruction::IType itype;
+// False for tokens that are not instruction keywords.
+constexpr bool Token::tokenToIType(Token::Type token_type, Instruction::IType& itype) {
     switch (token_type) {
         case (Token::PUSH): itype = Instruction::IPUSH; break;
         case (Token::POP): itype = Instruction::IPOP; break;
@@ -56,12 +49,9 @@ Instruction::IType Token::tokenToIType(Token::Type token_type) {
         case (Token::STORE): itype = Instruction::ISTORE; break;
         case (Token::LOAD): itype = Instruction::ILOAD; break;
         case (Token::PRINT): itype = Instruction::IPRINT; break;
-        default:
-            std::cout << "Error: Unknown Keyword type" << std::endl;
-            exit(0);
+        default: return false;
     }
-    
-    return itype;
+    return true;
 }
 
 #endif // Syntax_Analysis_TOKEN_H
@@ -0,0 +1,80 @@
+#ifndef Syntax_Analysis_TRACE_H
+#define Syntax_Analysis_TRACE_H
+
+#include <atomic>
+#include <ostream>
+#include <thread>
+#include "bytecode.h"
+#include "status.h"
+
+// One event of a traced run. Everything else about the run follows from the program, so only
+// what cannot be derived from it is recorded: the outcome of every conditional jump (value 0 or
+// 1) and the value of every store to a register (store and tee), each at its pc. A run is framed
+// by records whose pc is a TraceKind: BEGIN (value = first pc), PROGRAM (its size in words),
+// CHECKSUM (of its code), one REGISTER per register, one STACK per initial slot, bottom first,
+// and at the end two STEPS (the instructions it completed, low then high 32 bits) followed by
+// HALTED or FAILED (value = the pc it stopped at).
+struct TraceRecord {
+    int32_t pc;
+    int32_t value;
+};
+
+enum TraceKind : int32_t { TRACE_BEGIN = -1, TRACE_PROGRAM = -2, TRACE_CHECKSUM = -3, TRACE_REGISTER = -4,
+                           TRACE_STACK = -5, TRACE_HALTED = -6, TRACE_FAILED = -7, TRACE_STEPS = -8 };
+
+// Binary execution trace of the runs of one thread. Records go into a single-producer ring that
+// a background thread drains to the file, so the running SVM never waits on the disk unless the
+// ring is full. The producer publishes its position every 256 records and at end(); it must be
+// the only thread calling record(), begin() and end().
+class Trace {
+private:
+    std::unique_ptr<TraceRecord[]> slots;
+    size_t mask;
+    size_t head, limit;
+    std::atomic<size_t> published, consumed;
+    std::atomic<bool> closing, write_failed;
+    int fd;
+    std::thread flusher;
+
+    void wait_for_room();
+    void drain();
+    bool write_all(const void*, size_t);
+
+public:
+    Trace();
+    ~Trace();
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+
+    Status open(const std::string& path, size_t capacity = 1 << 18);
+    Status close();
+
+    void begin(const Program&, int pc, const int* registers, const int* stack, int depth);
+    void end(int pc, bool failed, long long steps);
+    void publish();
+
+    void record(int pc, int value);
+};
+
+inline void Trace::record(int pc, int value) {
+    if (head == limit) this->wait_for_room();
+    slots[head & mask] = TraceRecord{ pc, value };
+    if ((++head & 255) == 0) published.store(head, std::memory_order_release);
+}
+
+// Machine state after some number of instructions of a trace, rebuilt by walking the program
+// along the recorded path. `pc` is the instruction executed last (-1 before the first).
+struct ReplayState {
+    int registers[8];
+    std::vector<int> stack;
+    long long step;
+    int run;
+    int pc;
+    bool taken;
+    bool ended, failed;
+};
+
+Status replay_trace(const Program&, const std::string& path, long long step, ReplayState&);
+Status inspect_trace(const Program&, const std::string& path, long long step, std::ostream&);
+
+#endif // Syntax_Analysis_TRACE_H
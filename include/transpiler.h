@@ -0,0 +1,10 @@
+#ifndef Syntax_Analysis_TRANSPILER_H
+#define Syntax_Analysis_TRANSPILER_H
+
+#include <ostream>
+#include "status.h"
+#include "verifier.h"
+
+Status emit_cpp(const Program&, std::ostream&);
+
+#endif // Syntax_Analysis_TRANSPILER_H
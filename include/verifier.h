@@ -0,0 +1,21 @@
+#ifndef Syntax_Analysis_VERIFIER_H
+#define Syntax_Analysis_VERIFIER_H
+
+#include "bytecode.h"
+
+// Result of the static stack-depth analysis. depth[pc] is the operand-stack depth on entry to
+// pc, or -1 when pc is unreachable. A verified program can never underflow, always has the
+// same depth at a given pc, never needs more than max_depth slots and only names registers 0-7.
+struct Verification {
+    bool ok;
+    int max_depth;
+    int error_pc;
+    std::string error;
+    std::vector<int> depth;
+    std::vector<int> worklist;  // scratch for verify(), kept so re-verifying does not allocate
+};
+
+Verification verify(const Program&);
+void verify(const Program&, Verification&);
+
+#endif // Syntax_Analysis_VERIFIER_H
@@ -0,0 +1,5 @@
+#include "../include/Instruction.h"
+
+const char* Instruction::snames[18] = { "push", "pop", "dup", "swap", "add", "sub", "mult", "div", 
+                                        "goto", "jmpeq", "jmpgt", "jmpge", "jmplt", "jmple", "skip", 
+                                        "store", "load", "print" };
@@ -0,0 +1,74 @@
+#include "../include/arena.h"
+
+Arena::Arena(size_t block_size): head(nullptr), cursor(nullptr), limit(nullptr), block_size(block_size) {}
+
+Arena::~Arena() { this->release(); }
+
+Arena::Arena(Arena&& other)
+    : head(other.head), cursor(other.cursor), limit(other.limit), block_size(other.block_size) {
+    other.head = nullptr;
+    other.cursor = other.limit = nullptr;
+}
+
+Arena& Arena::operator=(Arena&& other) {
+    if (this != &other) {
+        this->release();
+        head = other.head;
+        cursor = other.cursor;
+        limit = other.limit;
+        block_size = other.block_size;
+        other.head = nullptr;
+        other.cursor = other.limit = nullptr;
+    }
+    return *this;
+}
+
+void Arena::grow(size_t size) {
+    size_t payload = size > block_size ? size : block_size;
+    Block* block = static_cast<Block*>(std::malloc(sizeof(Block) + payload));
+    if (!block) throw std::bad_alloc();
+
+    block->next = head;
+    block->size = payload;
+    head = block;
+    cursor = reinterpret_cast<char*>(block + 1);
+    limit = cursor + payload;
+}
+
+// Takes over every block of `other`, so views into it stay valid for this arena's lifetime.
+// Allocation continues in this arena's current block.
+void Arena::adopt(Arena&& other) {
+    if (!other.head) return;
+    if (!head) {
+        *this = std::move(other);
+        return;
+    }
+    Block* tail = other.head;
+    while (tail->next) tail = tail->next;
+    tail->next = head->next;
+    head->next = other.head;
+    other.head = nullptr;
+    other.cursor = other.limit = nullptr;
+}
+
+// Frees every block but the newest and rewinds into it. Views into the arena become invalid.
+void Arena::clear() {
+    if (!head) return;
+    Block* keep = head;
+    head = head->next;
+    this->release();
+    keep->next = nullptr;
+    head = keep;
+    cursor = reinterpret_cast<char*>(keep + 1);
+    limit = cursor + keep->size;
+}
+
+void Arena::release() {
+    while (head) {
+        Block* next = head->next;
+        std::free(head);
+        head = next;
+    }
+    cursor = limit = nullptr;
+}
+
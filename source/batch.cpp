@@ -0,0 +1,68 @@
+#include <sstream>
+#include "../include/batch.h"
+
+// One input set: up to 8 register values (r0 first, the rest zero), optionally followed by `|`
+// and the initial stack, bottom first. An empty line is all-zero registers and an empty stack.
+bool parse_batch_input(const std::string& line, BatchInput& input) {
+    input = BatchInput();
+    size_t bar = line.find('|');
+    std::istringstream registers(line.substr(0, bar));
+    int count = 0, value;
+    while (registers >> value) {
+        if (count == 8) break;
+        input.registers[count++] = value;
+    }
+    bool valid = registers.eof() && count <= 8;
+    if (bar != std::string::npos) {
+        std::istringstream stack(line.substr(bar + 1));
+        while (stack >> value) input.stack.push_back(value);
+        valid = valid && stack.eof();
+    }
+    return valid;
+}
+
+// Reads one input set per line in the format of parse_batch_input(). Blank lines and `%`
+// comments are skipped.
+Status read_batch_inputs(std::istream& in, std::vector<BatchInput>& inputs) {
+    inputs.clear();
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        line = line.substr(0, line.find('%'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        BatchInput input;
+        if (!parse_batch_input(line, input)) {
+            return Status(Status::INVALID_INPUT, "Invalid batch input on line " + std::to_string(number));
+        }
+        inputs.push_back(std::move(input));
+    }
+    return Status();
+}
+
+// Runs `executable` once per input on `pool` and returns each run's output (prints followed by
+// the final stack, or the runtime error that stopped it) in input order. Each worker owns one
+// SVM, reset between inputs, and writes into its own buffer, so the only shared state is the
+// read-only Executable.
+std::vector<std::string> run_batch(std::shared_ptr<Executable> executable, const std::vector<BatchInput>& inputs,
+                                   WorkStealingPool& pool) {
+    std::vector<std::string> outputs(inputs.size());
+    std::vector<std::unique_ptr<SVM>> machines;
+    std::vector<std::unique_ptr<std::ostringstream>> buffers;
+    for (int w = 0; w < pool.size(); w++) {
+        machines.emplace_back(new SVM(executable));
+        buffers.emplace_back(new std::ostringstream());
+        machines.back()->set_output(*buffers.back());
+    }
+
+    pool.parallel_for(inputs.size(), [&](size_t i, int worker) {
+        SVM& svm = *machines[worker];
+        std::ostringstream& buffer = *buffers[worker];
+        svm.reset(inputs[i].registers, inputs[i].stack);
+        Status status = svm.execute();
+        if (status.ok()) svm.print_stack();
+        else buffer << "error: " << status.message << std::endl;
+        outputs[i] = buffer.str();
+        buffer.str("");
+    });
+    return outputs;
+}
@@ -0,0 +1,46 @@
+#include "../include/bytecode.h"
+
+std::string_view DebugInfo::label_at(int pc) const {
+    std::vector<std::pair<int, std::string_view>>::const_iterator it = std::lower_bound(
+        labels.begin(), labels.end(), pc,
+        [](const std::pair<int, std::string_view>& entry, int key) { return entry.first < key; });
+    return (it != labels.end() && it->first == pc) ? it->second : std::string_view();
+}
+
+Program::Program(): code(1, Op{ OP_HALT, 0 }), image_code(nullptr), image_size(0) {}
+
+Program::Program(const std::vector<Instruction>& instructions, Arena&& strings): image_code(nullptr), image_size(0) {
+    this->assign(instructions, std::move(strings));
+}
+
+// Replaces the whole program, reusing the storage of the code and label vectors.
+void Program::assign(const std::vector<Instruction>& instructions, Arena&& strings) {
+    image.reset();
+    image_code = nullptr;
+    image_size = 0;
+    code.clear();
+    debug.labels.clear();
+    code.reserve(instructions.size() + 1);
+    for (int i = 0; i < instructions.size(); i++) {
+        const Instruction& instr = instructions[i];
+        code.push_back(Op{ static_cast<uint32_t>(instr.itype), instr.argument_int });
+        if (instr.label != "") debug.labels.emplace_back(i, instr.label);
+    }
+    code.push_back(Op{ OP_HALT, 0 });
+    debug.strings = std::move(strings);
+}
+
+bool Program::has_operand(uint32_t opcode) {
+    return opcode == Instruction::IPUSH || opcode == Instruction::ISTORE || opcode == Instruction::ILOAD ||
+           is_jump(opcode) || (opcode > OP_HALT && opcode < NUM_OPCODES);
+}
+
+bool Program::is_jump(uint32_t opcode) {
+    return (opcode >= Instruction::IGOTO && opcode <= Instruction::IJMPLE) ||
+           (opcode >= OP_LOAD_JMPEQ && opcode <= OP_LOAD_JMPLE);
+}
+
+bool Program::uses_register(uint32_t opcode) {
+    return opcode == Instruction::ISTORE || opcode == Instruction::ILOAD || opcode == OP_LOADADD || opcode == OP_TEE;
+}
+
@@ -0,0 +1,32 @@
+#include "../include/engine.h"
+#include "../include/optimizer.h"
+
+Engine::Engine()
+    : scanner(std::string_view()), parser(&scanner), current(std::make_shared<Executable>(Program())), svm(current) {}
+
+// Parses `source` into the current Executable and loads it into the SVM. On error the previous
+// program stays loaded.
+Status Engine::compile(std::string_view source, int level) {
+    // Held by this Engine, its SVM and `target` only: safe to overwrite in place.
+    std::shared_ptr<Executable> target = current;
+    if (target.use_count() > 3) target = std::make_shared<Executable>(Program());
+    scanner = Scanner(source);
+    parser.reset(&scanner);
+    Status status = parser.parseProgram(target->program);
+    if (!status.ok()) return status;
+    if (level > 0) target->program = optimize(std::move(target->program), level);
+    target->reload();
+    current = std::move(target);
+    svm.load(current);
+    return status;
+}
+
+Status Engine::run(std::ostream& out, const int* registers, const std::vector<int>& stack) {
+    svm.set_output(out);
+    svm.reset(registers, stack);
+    return svm.execute();
+}
+
+std::shared_ptr<Executable> Engine::executable() { return current; }
+
+SVM& Engine::machine() { return svm; }
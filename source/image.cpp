@@ -0,0 +1,118 @@
+#include <fstream>
+#include "../include/image.h"
+
+namespace image {
+
+uint64_t checksum(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < length; i++) hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+    return hash;
+}
+
+size_t labels_offset(const Header& header) {
+    size_t end_of_pool = sizeof(Header) + (header.code_count + (size_t)1) * sizeof(Op) + header.pool_size;
+    return (end_of_pool + 3) & ~static_cast<size_t>(3);
+}
+
+bool is_image(std::string_view bytes) {
+    return bytes.size() >= sizeof(Header) && std::memcmp(bytes.data(), MAGIC, 4) == 0;
+}
+
+Status invalid(const std::string& msg) { return Status(Status::INVALID_IMAGE, "Invalid program image: " + msg); }
+
+} // namespace image
+
+Status write_image(const Program& program, const std::string& path, bool with_debug) {
+    image::Header header;
+    std::memcpy(header.magic, image::MAGIC, 4);
+    header.version = image::VERSION;
+    header.flags = with_debug ? image::FLAG_DEBUG : 0;
+    header.code_count = program.size();
+    header.pool_size = 0;
+    header.label_count = 0;
+
+    std::vector<image::LabelEntry> labels;
+    std::string pool;
+    if (with_debug) {
+        labels.reserve(program.debug.labels.size());
+        for (const std::pair<int, std::string_view>& label : program.debug.labels) {
+            labels.push_back(image::LabelEntry{ label.first, (uint32_t)pool.size(), (uint32_t)label.second.size() });
+            pool.append(label.second);
+        }
+        header.pool_size = pool.size();
+        header.label_count = labels.size();
+    }
+
+    std::string payload(reinterpret_cast<const char*>(program.data()), (program.size() + 1) * sizeof(Op));
+    payload += pool;
+    payload.resize(image::labels_offset(header) - sizeof(image::Header), '\0');
+    payload.append(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(image::LabelEntry));
+    header.checksum = image::checksum(payload.data(), payload.size());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(payload.data(), payload.size());
+    if (!out) return Status(Status::IO_ERROR, "Unable to write file " + path);
+    return Status();
+}
+
+// Validates the image once so the interpreter can trust every opcode and jump target. `out` is
+// replaced on success and untouched on error.
+Status load_image(std::unique_ptr<MappedFile> file, Program& out) {
+    std::string_view bytes = file->view();
+    if (!image::is_image(bytes)) return image::invalid("bad magic");
+
+    image::Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.version != image::VERSION) return image::invalid("unsupported version " + std::to_string(header.version));
+
+    size_t labels_at = image::labels_offset(header);
+    size_t expected = labels_at + (size_t)header.label_count * sizeof(image::LabelEntry);
+    if (bytes.size() != expected) return image::invalid("truncated or oversized file");
+    if (image::checksum(bytes.data() + sizeof(header), bytes.size() - sizeof(header)) != header.checksum)
+        return image::invalid("checksum mismatch");
+
+    Program program;
+    program.image_code = reinterpret_cast<const Op*>(bytes.data() + sizeof(header));
+    program.image_size = header.code_count;
+
+    std::vector<bool> starts(program.image_size + 1, false);
+    size_t i = 0;
+    while (i < program.image_size) {
+        const Op& op = program.image_code[i];
+        if (op.opcode >= NUM_OPCODES || op.opcode == OP_HALT) return image::invalid("unknown opcode at " + std::to_string(i));
+        starts[i] = true;
+        i += op_info[op.opcode].words;
+    }
+    if (i != program.image_size) return image::invalid("truncated instruction at end of code");
+    // The optimizer may leave a jump to the halt sentinel, as verify() allows.
+    starts[program.image_size] = true;
+    for (i = 0; i < program.image_size; i += op_info[program.image_code[i].opcode].words) {
+        const Op& op = program.image_code[i];
+        if (Program::is_jump(op.opcode) && (op.operand < 0 || op.operand > (int32_t)header.code_count || !starts[op.operand]))
+            return image::invalid("jump target out of range at " + std::to_string(i));
+    }
+
+    if (program.image_code[program.image_size].opcode != OP_HALT) return image::invalid("missing halt sentinel");
+
+    const char* pool = bytes.data() + sizeof(header) + (header.code_count + (size_t)1) * sizeof(Op);
+    program.debug.labels.reserve(header.label_count);
+    for (uint32_t i = 0; i < header.label_count; i++) {
+        image::LabelEntry entry;
+        std::memcpy(&entry, bytes.data() + labels_at + i * sizeof(entry), sizeof(entry));
+        if (entry.pc < 0 || entry.pc >= (int32_t)header.code_count || (uint64_t)entry.offset + entry.length > header.pool_size)
+            return image::invalid("label entry out of range");
+        if (i > 0 && entry.pc <= program.debug.labels.back().first) return image::invalid("label table not sorted");
+        program.debug.labels.emplace_back(entry.pc, std::string_view(pool + entry.offset, entry.length));
+    }
+
+    program.image = std::move(file);
+    out = std::move(program);
+    return Status();
+}
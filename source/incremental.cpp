@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <iterator>
+#include "../include/incremental.h"
+
+// Replaces into[first, last) with `from`, moving the tail only when the lengths differ.
+template <typename T>
+static void splice(std::vector<T>& into, size_t first, size_t last, const std::vector<T>& from) {
+    size_t common = std::min(last - first, from.size());
+    std::copy(from.begin(), from.begin() + common, into.begin() + first);
+    if (from.size() > common) into.insert(into.begin() + last, from.begin() + common, from.end());
+    else into.erase(into.begin() + first + common, into.begin() + last);
+}
+
+// Swaps the `removed` entries of a sorted table for the `added` ones, touching only those that
+// differ; both lists are sorted. Used when no instruction moved.
+static void exchange(std::vector<std::pair<std::string_view, int>>& table,
+                     const std::vector<std::pair<std::string_view, int>>& removed,
+                     const std::vector<std::pair<std::string_view, int>>& added,
+                     std::vector<std::pair<std::string_view, int>>& scratch) {
+    scratch.clear();
+    std::set_difference(removed.begin(), removed.end(), added.begin(), added.end(), std::back_inserter(scratch));
+    for (const auto& entry : scratch) table.erase(std::lower_bound(table.begin(), table.end(), entry));
+    scratch.clear();
+    std::set_difference(added.begin(), added.end(), removed.begin(), removed.end(), std::back_inserter(scratch));
+    for (const auto& entry : scratch) table.insert(std::upper_bound(table.begin(), table.end(), entry), entry);
+    scratch.clear();
+}
+
+// Drops the entries of a sorted table for instructions [first, last), moves the later ones by
+// `delta` and merges in the sorted `added` ones.
+static void respread(std::vector<std::pair<std::string_view, int>>& table, size_t first, size_t last, int delta,
+                     const std::vector<std::pair<std::string_view, int>>& added) {
+    size_t kept = 0;
+    for (size_t i = 0; i < table.size(); i++) {
+        std::pair<std::string_view, int> entry = table[i];
+        if (entry.second >= static_cast<int>(first) && entry.second < static_cast<int>(last)) continue;
+        if (entry.second >= static_cast<int>(last)) entry.second += delta;
+        table[kept++] = entry;
+    }
+    table.resize(kept);
+    table.insert(table.end(), added.begin(), added.end());
+    std::inplace_merge(table.begin(), table.begin() + kept, table.end());
+}
+
+IncrementalCompiler::IncrementalCompiler()
+    : source_lines(1), parser(nullptr), current(std::make_shared<Executable>(Program())), pending(false),
+      in_sync(true), verified(true), truncated(false), nul_bytes(0), string_bytes(0), string_limit(64 * 1024) {}
+
+// Verification covers the whole program, so it waits until the program is asked for.
+std::shared_ptr<Executable> IncrementalCompiler::executable() {
+    if (!verified) current->reload();
+    verified = true;
+    return current;
+}
+
+std::string IncrementalCompiler::source() const {
+    std::string text;
+    for (const std::string& line : source_lines) text += line;
+    return text;
+}
+
+size_t IncrementalCompiler::lines() const { return source_lines.size(); }
+
+// Every line but the last ends with its newline; the last one, empty when the text ends with a
+// newline, has none.
+void IncrementalCompiler::split_into(std::string_view text, bool ends_text, std::vector<std::string>& into) {
+    size_t start = 0;
+    for (size_t at = text.find('\n'); at != std::string_view::npos; at = text.find('\n', at + 1)) {
+        into.emplace_back(text.substr(start, at + 1 - start));
+        start = at + 1;
+    }
+    if (ends_text) into.emplace_back(text.substr(start));
+}
+
+Status IncrementalCompiler::compile(std::string_view source) {
+    source_lines.clear();
+    split_into(source, true, source_lines);
+    nul_bytes = std::count(source.begin(), source.end(), '\0');
+    truncated = nul_bytes > 0;
+    program.clear();
+    first_line.clear();
+    jumps.clear();
+    missing.clear();
+    labels.clear();
+    references.clear();
+    pending = false;
+    in_sync = false;
+    // The names of the whole text are copied once; let them be before counting them as waste.
+    string_limit = string_bytes + 2 * source.size() + 64 * 1024;
+    return this->recompile(0, 0);
+}
+
+// Replaces lines [line, line + count) with `replacement`, which holds its own newlines; a
+// count of 0 inserts before `line`.
+//
+// The re-parsed range starts at the last instruction that starts strictly before the edit, so
+// the scan begins on an untouched line where the whole text's scanner would be between
+// instructions, and ends after the first instruction that starts after it, so that a
+// replacement without a final newline still joins the line that follows. A NUL byte, which
+// ends the scanner's input wherever it is not commented out, makes every edit re-parse it all.
+Status IncrementalCompiler::update(size_t line, size_t count, std::string_view replacement) {
+    if (line + count > source_lines.size()) return Status(Status::INVALID_INPUT, "Edit past the last line");
+    nul_bytes += std::count(replacement.begin(), replacement.end(), '\0');
+    for (size_t i = line; i < line + count; i++) nul_bytes -= std::count(source_lines[i].begin(), source_lines[i].end(), '\0');
+
+    size_t first = 0, last = program.size();
+    if (!truncated && nul_bytes == 0) {
+        first = std::lower_bound(first_line.begin(), first_line.end(), line) - first_line.begin();
+        first = first > 0 ? first - 1 : 0;
+        last = std::lower_bound(first_line.begin(), first_line.end(), line + count) - first_line.begin();
+        last = std::min(last + 1, program.size());
+        if (pending) {
+            first = std::min(first, pending_first);
+            last = std::max(last, pending_last);
+        }
+    }
+    truncated = nul_bytes > 0;
+    this->splice_lines(line, count, replacement, last);
+    return this->recompile(first, last);
+}
+
+// Edits the lines, and moves the start line of every instruction from `shift_from` on, all of
+// which start after the edit. A replacement without a final newline runs into the line after
+// it, which is split again together with it.
+void IncrementalCompiler::splice_lines(size_t line, size_t count, std::string_view replacement, size_t shift_from) {
+    size_t last = line + count;
+    std::string_view piece = replacement;
+    if (line == source_lines.size()) {
+        // Past the last line, which has no newline: the replacement goes on the end of it.
+        joined = source_lines[--line];
+        joined.append(replacement.data(), replacement.size());
+        piece = joined;
+    } else if (last < source_lines.size() && (replacement.empty() || replacement.back() != '\n')) {
+        joined.assign(replacement.data(), replacement.size());
+        joined += source_lines[last++];
+        piece = joined;
+    }
+    pieces.clear();
+    split_into(piece, last == source_lines.size(), pieces);
+    splice(source_lines, line, last, pieces);
+
+    size_t added = pieces.size() - (last - line);
+    if (added == 0) return;
+    for (size_t i = shift_from; i < first_line.size(); i++) first_line[i] += added;
+}
+
+// Parses lines [begin, end) into the parser's buffers, recording the line each instruction
+// starts on.
+Status IncrementalCompiler::parse_region(size_t begin, size_t end) {
+    region.clear();
+    for (size_t i = begin; i < end; i++) region += source_lines[i];
+    Scanner scanner(region);
+    parser.reset(&scanner);
+    parser.program.clear();
+    parser.jumps.clear();
+    parser.arena.clear();
+    region_lines.clear();
+
+    // The first token of a later region is read by advance() in the sequential parser.
+    parser.current = scanner.next_token();
+    if (parser.check(Token::ERR)) {
+        if (begin == 0) parser.error("Error: Invalid character");
+        else parser.error("Parse error, unrecognised character: " + std::string(parser.current.lexeme));
+    }
+    size_t line = begin, counted = 0;
+    while (parser.current.type != Token::END && parser.failure.ok()) {
+        // An instruction's first token ends on the line it starts on.
+        size_t at = scanner.position() - 1;
+        line += std::count(region.begin() + counted, region.begin() + at, '\n');
+        counted = at;
+        region_lines.push_back(line);
+        parser.parseInstruction();
+    }
+    return parser.failure;
+}
+
+// Re-parses instructions [first, last) from the current text and splices the result in.
+Status IncrementalCompiler::recompile(size_t first, size_t last) {
+    size_t count = program.size();
+    size_t begin, end;
+    Status status;
+    while (true) {
+        begin = first == 0 ? 0 : first_line[first];
+        end = last == count ? source_lines.size() : first_line[last];
+        status = this->parse_region(begin, end);
+        // An error at the end of the region may be one the lines after it would have avoided,
+        // such as a label whose instruction follows a comment.
+        if (status.ok() || parser.current.type != Token::END || last == count) break;
+        last = std::min(count, last + std::max<size_t>(last - first, 1));
+    }
+    if (!status.ok()) {
+        // Kept monotonic so the next update() can still search the start lines.
+        std::fill(first_line.begin() + first, first_line.begin() + last, begin);
+        pending = true;
+        pending_first = first;
+        pending_last = last;
+        return status;
+    }
+    pending = false;
+
+    Arena& strings = current->program.debug.strings;
+    for (Instruction& instr : parser.program) {
+        instr.label = strings.copy(instr.label);
+        instr.jmp_label = strings.copy(instr.jmp_label);
+        string_bytes += instr.label.size() + instr.jmp_label.size();
+    }
+    size_t added = parser.program.size(), region_end = first + added;
+    int delta = static_cast<int>(added) - static_cast<int>(last - first);
+    size_t jumps_first = std::lower_bound(jumps.begin(), jumps.end(), first) - jumps.begin();
+    size_t jumps_last = std::lower_bound(jumps.begin(), jumps.end(), last) - jumps.begin();
+    for (size_t& k : parser.jumps) k += first;
+
+    // The names the old and the new lines define and refer to, by instruction.
+    old_labels.clear();
+    new_labels.clear();
+    old_references.clear();
+    new_references.clear();
+    for (size_t k = first; k < last; k++) {
+        if (program[k].label != "") old_labels.emplace_back(program[k].label, static_cast<int>(k));
+    }
+    for (size_t k = 0; k < added; k++) {
+        if (parser.program[k].label != "") new_labels.emplace_back(parser.program[k].label, static_cast<int>(first + k));
+    }
+    for (size_t i = jumps_first; i < jumps_last; i++) old_references.emplace_back(program[jumps[i]].jmp_label, static_cast<int>(jumps[i]));
+    for (size_t k : parser.jumps) new_references.emplace_back(parser.program[k - first].jmp_label, static_cast<int>(k));
+    std::sort(old_labels.begin(), old_labels.end());
+    std::sort(new_labels.begin(), new_labels.end());
+    std::sort(old_references.begin(), old_references.end());
+    std::sort(new_references.begin(), new_references.end());
+
+    // A name may resolve elsewhere once one of its definitions moves, so with the instructions
+    // after the edit in place only the definitions that changed count; otherwise every one in
+    // the old or the new lines does.
+    touched.clear();
+    if (delta == 0) {
+        std::set_symmetric_difference(old_labels.begin(), old_labels.end(), new_labels.begin(), new_labels.end(),
+                                      std::back_inserter(changed));
+        for (const Definition& definition : changed) touched.push_back(definition.first);
+        changed.clear();
+        exchange(labels, old_labels, new_labels, changed);
+        exchange(references, old_references, new_references, changed);
+    } else {
+        for (const Definition& definition : old_labels) touched.push_back(definition.first);
+        for (const Definition& definition : new_labels) touched.push_back(definition.first);
+        respread(labels, first, last, delta, new_labels);
+        respread(references, first, last, delta, new_references);
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+    splice(program, first, last, parser.program);
+    splice(first_line, first, last, region_lines);
+    if (delta != 0) {
+        for (size_t i = jumps_last; i < jumps.size(); i++) jumps[i] += delta;
+    }
+    splice(jumps, jumps_first, jumps_last, parser.jumps);
+
+    size_t missing_first = std::lower_bound(missing.begin(), missing.end(), first) - missing.begin();
+    size_t missing_last = std::lower_bound(missing.begin(), missing.end(), last) - missing.begin();
+    if (delta != 0) {
+        for (size_t i = missing_last; i < missing.size(); i++) missing[i] += delta;
+    }
+    missing.erase(missing.begin() + missing_first, missing.begin() + missing_last);
+
+    // Jumps outside the new lines keep their targets, moved with the instructions after the
+    // edit, unless they name a touched label, when they are found through the references.
+    // Unresolved jumps are kept in program order so the first one is the error the whole-text
+    // parser reports.
+    size_t region_jumps_last = jumps_first + parser.jumps.size();
+    if (delta != 0) {
+        for (size_t i = 0; i < jumps.size(); i++) {
+            if (i == jumps_first) i = region_jumps_last;
+            if (i == jumps.size()) break;
+            int& target = program[jumps[i]].argument_int;
+            if (target >= static_cast<int>(last)) target += delta;
+        }
+    }
+    retargeted.clear();
+    still_missing.clear();
+    for (size_t i = jumps_first; i < region_jumps_last; i++) {
+        if (!this->resolve(jumps[i])) still_missing.push_back(jumps[i]);
+    }
+    for (std::string_view name : touched) {
+        auto by_name = [](const Definition& reference, std::string_view key) { return reference.first < key; };
+        std::vector<Definition>::const_iterator it = std::lower_bound(references.begin(), references.end(), name, by_name);
+        for (; it != references.end() && it->first == name; ++it) {
+            size_t k = it->second;
+            if (k >= first && k < region_end) continue;
+            if (this->resolve(k)) retargeted.push_back(k);
+            else still_missing.push_back(k);
+        }
+    }
+    if (!retargeted.empty()) {
+        std::sort(retargeted.begin(), retargeted.end());
+        std::vector<size_t>::iterator kept = std::remove_if(missing.begin(), missing.end(),
+            [this](size_t k) { return std::binary_search(retargeted.begin(), retargeted.end(), k); });
+        missing.erase(kept, missing.end());
+    }
+    if (!still_missing.empty()) {
+        size_t old = missing.size();
+        missing.insert(missing.end(), still_missing.begin(), still_missing.end());
+        std::sort(missing.begin() + old, missing.end());
+        std::inplace_merge(missing.begin(), missing.begin() + old, missing.end());
+        missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    }
+    if (!missing.empty()) {
+        in_sync = false;
+        return Status(Status::UNKNOWN_LABEL, "No label found: " + std::string(program[missing.front()].jmp_label));
+    }
+
+    if (current.use_count() > 1 || string_bytes > string_limit) this->rehome();
+    if (in_sync) this->patch(first, last, added, delta != 0);
+    else this->lower();
+    in_sync = true;
+    verified = false;
+    return Status();
+}
+
+bool IncrementalCompiler::resolve(size_t k) {
+    std::string_view name = program[k].jmp_label;
+    std::vector<Definition>::const_iterator it = std::upper_bound(labels.begin(), labels.end(), name,
+        [](std::string_view key, const Definition& d) { return key < d.first; });
+    if (it == labels.begin() || (it - 1)->first != name) return false;
+    program[k].argument_int = (it - 1)->second;
+    return true;
+}
+
+// Brings code that matched the program before the splice of [first, last) up to date: the new
+// words, the operands of retargeted jumps, or of every jump when the code after the edit moved.
+void IncrementalCompiler::patch(size_t first, size_t last, size_t added, bool moved) {
+    Program& out = current->program;
+    words.clear();
+    entries.clear();
+    for (size_t k = first; k < first + added; k++) {
+        words.push_back(Op{ static_cast<uint32_t>(program[k].itype), program[k].argument_int });
+        if (program[k].label != "") entries.emplace_back(static_cast<int>(k), program[k].label);
+    }
+    splice(out.code, first, last, words);
+    if (moved) {
+        for (size_t k : jumps) out.code[k].operand = program[k].argument_int;
+    } else {
+        for (size_t k : retargeted) out.code[k].operand = program[k].argument_int;
+    }
+
+    typedef std::pair<int, std::string_view> Entry;
+    std::vector<Entry>& table = out.debug.labels;
+    auto by_pc = [](const Entry& entry, int pc) { return entry.first < pc; };
+    size_t table_first = std::lower_bound(table.begin(), table.end(), static_cast<int>(first), by_pc) - table.begin();
+    size_t table_last = std::lower_bound(table.begin(), table.end(), static_cast<int>(last), by_pc) - table.begin();
+    int delta = static_cast<int>(added) - static_cast<int>(last - first);
+    if (moved) {
+        for (size_t i = table_last; i < table.size(); i++) table[i].first += delta;
+    }
+    splice(table, table_first, table_last, entries);
+}
+
+// Lowers the whole instruction array, as Program::assign() does, into the current program.
+void IncrementalCompiler::lower() {
+    Program& out = current->program;
+    out.code.clear();
+    out.debug.labels.clear();
+    out.code.reserve(program.size() + 1);
+    for (size_t k = 0; k < program.size(); k++) {
+        out.code.push_back(Op{ static_cast<uint32_t>(program[k].itype), program[k].argument_int });
+        if (program[k].label != "") out.debug.labels.emplace_back(static_cast<int>(k), program[k].label);
+    }
+    out.code.push_back(Op{ OP_HALT, 0 });
+}
+
+// Moves the instructions' names into a fresh Executable, leaving the shared one untouched. Also
+// how names orphaned by earlier edits are let go once they outweigh the live ones.
+void IncrementalCompiler::rehome() {
+    std::shared_ptr<Executable> previous = std::move(current);
+    current = std::make_shared<Executable>(Program());
+    Arena& strings = current->program.debug.strings;
+    string_bytes = 0;
+    for (Instruction& instr : program) {
+        instr.label = strings.copy(instr.label);
+        instr.jmp_label = strings.copy(instr.jmp_label);
+        string_bytes += instr.label.size() + instr.jmp_label.size();
+    }
+    for (Definition& definition : labels) definition.first = program[definition.second].label;
+    for (Definition& reference : references) reference.first = program[reference.second].jmp_label;
+    string_limit = 2 * string_bytes + 64 * 1024;
+    in_sync = false;
+}
@@ -0,0 +1,335 @@
+#include <climits>
+#include "../include/jit.h"
+#ifdef SVM_JIT
+#include <sys/mman.h>
+#endif
+
+JitCode::JitCode(const std::vector<uint8_t>& bytes, std::vector<int>&& entries)
+    : memory(nullptr), length(bytes.size()), entries(std::move(entries)) {
+#ifdef SVM_JIT
+    void* map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return;
+    std::memcpy(map, bytes.data(), length);
+    if (mprotect(map, length, PROT_READ | PROT_EXEC) != 0) {
+        munmap(map, length);
+        return;
+    }
+    memory = static_cast<uint8_t*>(map);
+#endif
+}
+
+JitCode::~JitCode() {
+#ifdef SVM_JIT
+    if (memory) munmap(memory, length);
+#endif
+}
+
+bool JitCode::is_ready() const { return memory != nullptr; }
+bool JitCode::can_enter(int pc) const { return pc >= 0 && pc < entries.size() && entries[pc] >= 0; }
+size_t JitCode::code_bytes() const { return length; }
+
+int JitCode::run(int* stack, int* registers, int pc) const {
+    Function function = reinterpret_cast<Function>(memory);
+    return function(stack, registers, memory + entries[pc]);
+}
+
+namespace jit {
+
+enum Reg { RAX = 0, RCX = 1, RDX = 2, RSI = 6, RDI = 7, R8 = 8, R9 = 9, R10 = 10, R11 = 11 };
+enum Cond { CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+const int pool[] = { RAX, RCX, RDX, R8, R9, R10, R11 };
+
+// Just the handful of 32-bit encodings the compiler needs. Memory operands are always
+// [rdi|rsi + disp32], which never needs a SIB byte.
+class Assembler {
+public:
+    std::vector<uint8_t> bytes;
+
+    void byte(uint8_t value) { bytes.push_back(value); }
+    void dword(int32_t value) {
+        for (int i = 0; i < 4; i++) bytes.push_back(static_cast<uint32_t>(value) >> (8 * i));
+    }
+    void rex(int reg, int rm) {
+        if (reg >= 8 || rm >= 8) byte(0x40 | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0));
+    }
+    void direct(int reg, int rm) { byte(0xC0 | (reg & 7) << 3 | (rm & 7)); }
+    void indirect(int reg, int base, int32_t disp) {
+        byte(0x80 | (reg & 7) << 3 | (base & 7));
+        dword(disp);
+    }
+
+    void mov_imm(int dst, int32_t value) { rex(0, dst); byte(0xB8 + (dst & 7)); dword(value); }
+    void mov(int dst, int src) { rex(src, dst); byte(0x89); direct(src, dst); }
+    void load(int dst, int base, int32_t disp) { rex(dst, base); byte(0x8B); indirect(dst, base, disp); }
+    void store(int base, int32_t disp, int src) { rex(src, base); byte(0x89); indirect(src, base, disp); }
+    void alu(uint8_t opcode, int dst, int src) { rex(src, dst); byte(opcode); direct(src, dst); }
+    void alu_imm(int ext, int dst, int32_t value) { rex(0, dst); byte(0x81); direct(ext, dst); dword(value); }
+    void add_mem(int dst, int base, int32_t disp) { rex(dst, base); byte(0x03); indirect(dst, base, disp); }
+    void cmp_mem_imm(int base, int32_t disp, int32_t value) { byte(0x81); indirect(7, base, disp); dword(value); }
+    void imul(int dst, int src) { rex(dst, src); byte(0x0F); byte(0xAF); direct(dst, src); }
+    void imul_imm(int dst, int32_t value) { rex(dst, dst); byte(0x69); direct(dst, dst); dword(value); }
+    void idiv(int src) { byte(0x99); rex(0, src); byte(0xF7); direct(7, src); }
+    void ret() { byte(0xC3); }
+    void jmp_rdx() { byte(0xFF); byte(0xE2); }
+    size_t jmp() { byte(0xE9); dword(0); return bytes.size() - 4; }
+    size_t jcc(int cond) { byte(0x0F); byte(0x80 | cond); dword(0); return bytes.size() - 4; }
+    void patch(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(target) - static_cast<int32_t>(at + 4);
+        for (int i = 0; i < 4; i++) bytes[at + i] = static_cast<uint32_t>(rel) >> (8 * i);
+    }
+};
+
+enum { ADD = 0x01, SUB = 0x29, CMP = 0x39, TEST = 0x85, EXT_ADD = 0, EXT_SUB = 5, EXT_CMP = 7 };
+
+bool supported(uint32_t opcode) {
+    return opcode != Instruction::IPRINT && opcode < NUM_OPCODES;
+}
+
+int condition(uint32_t opcode) {
+    switch (opcode) {
+        case Instruction::IJMPEQ: case OP_LOAD_JMPEQ: return CC_E;
+        case Instruction::IJMPGT: case OP_LOAD_JMPGT: return CC_G;
+        case Instruction::IJMPGE: case OP_LOAD_JMPGE: return CC_GE;
+        case Instruction::IJMPLT: case OP_LOAD_JMPLT: return CC_L;
+        default: return CC_LE;
+    }
+}
+
+class Compiler {
+private:
+    const Program& program;
+    const Verification& verification;
+    Assembler as;
+    std::vector<int> cached;
+    bool in_use[16];
+    int depth;
+
+public:
+    Compiler(const Program& program, const Verification& verification)
+        : program(program), verification(verification), in_use(), depth(0) {}
+
+    std::unique_ptr<JitCode> compile();
+
+private:
+    int32_t slot(int k) { return 4 * k; }
+    int alloc();
+    void release(int);
+    void ensure(int);
+    int pop();
+    void push(int);
+    void spill();
+    void leave(int);
+};
+
+// Registers for the cached top of stack; when none is free the deepest cached entry goes back
+// to memory.
+int Compiler::alloc() {
+    for (int r : pool) {
+        if (!in_use[r]) {
+            in_use[r] = true;
+            return r;
+        }
+    }
+    as.store(RDI, slot(depth - (int)cached.size()), cached.front());
+    int r = cached.front();
+    cached.erase(cached.begin());
+    return r;
+}
+
+void Compiler::release(int r) { in_use[r] = false; }
+
+void Compiler::ensure(int count) {
+    while (cached.size() < count) {
+        int r = this->alloc();
+        as.load(r, RDI, slot(depth - (int)cached.size() - 1));
+        cached.insert(cached.begin(), r);
+    }
+}
+
+int Compiler::pop() {
+    int r = cached.back();
+    cached.pop_back();
+    depth--;
+    return r;
+}
+
+void Compiler::push(int r) {
+    cached.push_back(r);
+    depth++;
+}
+
+void Compiler::spill() {
+    for (int i = 0; i < cached.size(); i++) {
+        as.store(RDI, slot(depth - (int)cached.size() + i), cached[i]);
+        this->release(cached[i]);
+    }
+    cached.clear();
+}
+
+void Compiler::leave(int pc) {
+    this->spill();
+    as.mov_imm(RAX, pc);
+    as.ret();
+}
+
+std::unique_ptr<JitCode> Compiler::compile() {
+    const Op* code = program.data();
+    int n = program.size();
+
+    std::vector<bool> leader(n + 1, false);
+    leader[0] = leader[n] = true;
+    for (int pc = 0; pc < n; pc += op_info[code[pc].opcode].words) {
+        if (Program::is_jump(code[pc].opcode)) leader[code[pc].operand] = true;
+        if (!supported(code[pc].opcode)) leader[pc + op_info[code[pc].opcode].words] = true;
+    }
+
+    std::vector<int> entries(n + 1, -1);
+    std::vector<std::pair<size_t, int>> fixups;
+
+    as.jmp_rdx();
+    for (int pc = 0; pc <= n; pc += pc < n ? op_info[code[pc].opcode].words : 1) {
+        if (verification.depth[pc] < 0) continue;
+        if (leader[pc]) {
+            this->spill();
+            entries[pc] = as.bytes.size();
+        }
+        depth = verification.depth[pc];
+        if (pc == n) {
+            this->leave(n);
+            break;
+        }
+
+        const Op& op = code[pc];
+        int a, b;
+        switch (op.opcode) {
+            case Instruction::IPUSH:
+                a = this->alloc();
+                as.mov_imm(a, op.operand);
+                this->push(a);
+                break;
+            case Instruction::ILOAD:
+                a = this->alloc();
+                as.load(a, RSI, slot(op.operand));
+                this->push(a);
+                break;
+            case Instruction::ISTORE:
+                this->ensure(1);
+                a = this->pop();
+                as.store(RSI, slot(op.operand), a);
+                this->release(a);
+                break;
+            case Instruction::IPOP:
+                if (cached.empty()) depth--;
+                else this->release(this->pop());
+                break;
+            case Instruction::IDUP:
+                this->ensure(1);
+                a = this->alloc();
+                as.mov(a, cached.back());
+                this->push(a);
+                break;
+            case Instruction::ISWAP:
+                this->ensure(2);
+                std::swap(cached[cached.size() - 1], cached[cached.size() - 2]);
+                break;
+            case Instruction::IADD: case Instruction::ISUB: case Instruction::IMUL:
+                this->ensure(2);
+                b = this->pop();
+                a = cached.back();
+                if (op.opcode == Instruction::IADD) as.alu(ADD, a, b);
+                else if (op.opcode == Instruction::ISUB) as.alu(SUB, a, b);
+                else as.imul(a, b);
+                this->release(b);
+                break;
+            case Instruction::IDIV: {
+                // A division that would trap is left to the interpreter, which reports it.
+                this->spill();
+                as.load(RAX, RDI, slot(depth - 2));
+                as.load(RCX, RDI, slot(depth - 1));
+                as.alu(TEST, RCX, RCX);
+                size_t zero = as.jcc(CC_E);
+                as.alu_imm(EXT_CMP, RCX, -1);
+                size_t divisor_ok = as.jcc(CC_NE);
+                as.alu_imm(EXT_CMP, RAX, INT_MIN);
+                size_t dividend_ok = as.jcc(CC_NE);
+                as.patch(zero, as.bytes.size());
+                this->leave(pc);
+                as.patch(divisor_ok, as.bytes.size());
+                as.patch(dividend_ok, as.bytes.size());
+                as.idiv(RCX);
+                as.store(RDI, slot(depth - 2), RAX);
+                depth--;
+                break;
+            }
+            case Instruction::ISKIP:
+                break;
+            case Instruction::IGOTO:
+                this->spill();
+                fixups.emplace_back(as.jmp(), op.operand);
+                break;
+            case Instruction::IJMPEQ: case Instruction::IJMPGT: case Instruction::IJMPGE:
+            case Instruction::IJMPLT: case Instruction::IJMPLE:
+                this->ensure(2);
+                b = this->pop();
+                a = this->pop();
+                this->spill();
+                as.alu(CMP, a, b);
+                this->release(a);
+                this->release(b);
+                fixups.emplace_back(as.jcc(condition(op.opcode)), op.operand);
+                break;
+            case OP_ADDI: case OP_SUBI:
+                this->ensure(1);
+                as.alu_imm(op.opcode == OP_ADDI ? EXT_ADD : EXT_SUB, cached.back(), op.operand);
+                break;
+            case OP_MULI:
+                this->ensure(1);
+                as.imul_imm(cached.back(), op.operand);
+                break;
+            case OP_DUPSUBI:
+                this->ensure(1);
+                a = this->alloc();
+                as.mov(a, cached.back());
+                as.alu_imm(EXT_SUB, a, op.operand);
+                this->push(a);
+                break;
+            case OP_LOADADD:
+                this->ensure(1);
+                as.add_mem(cached.back(), RSI, slot(op.operand));
+                break;
+            case OP_TEE:
+                this->ensure(1);
+                as.store(RSI, slot(op.operand), cached.back());
+                break;
+            case OP_LOAD_JMPEQ: case OP_LOAD_JMPGT: case OP_LOAD_JMPGE:
+            case OP_LOAD_JMPLT: case OP_LOAD_JMPLE:
+                this->spill();
+                as.cmp_mem_imm(RSI, slot(code[pc + 1].opcode), code[pc + 1].operand);
+                fixups.emplace_back(as.jcc(condition(op.opcode)), op.operand);
+                break;
+            default:
+                this->leave(pc);
+                break;
+        }
+    }
+
+    for (const std::pair<size_t, int>& fixup : fixups) as.patch(fixup.first, entries[fixup.second]);
+
+    std::unique_ptr<JitCode> result(new JitCode(as.bytes, std::move(entries)));
+    if (!result->is_ready()) return nullptr;
+    return result;
+}
+
+} // namespace jit
+
+// Returns nullptr when the program cannot be compiled: it fails verification or there is no
+// backend for this platform. The caller keeps interpreting in that case.
+std::unique_ptr<JitCode> jit_compile(const Program& program, const Verification& verification) {
+#ifdef SVM_JIT
+    if (!verification.ok) return nullptr;
+    return jit::Compiler(program, verification).compile();
+#else
+    return nullptr;
+#endif
+}
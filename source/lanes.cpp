@@ -0,0 +1,234 @@
+#include <sstream>
+#include "../include/lanes.h"
+
+LaneVM::LaneVM(std::shared_ptr<Executable> executable)
+    : executable(std::move(executable)), vector_instructions(0), lane_instructions(0) {
+    slots.resize(this->executable->verification.max_depth + 1);
+}
+
+long long LaneVM::instructions_dispatched() { return vector_instructions; }
+long long LaneVM::lane_instructions_executed() { return lane_instructions; }
+
+void LaneVM::activate(unsigned lanes) {
+    active = lanes;
+    active_mask = lanes::mask(lanes);
+}
+
+// Queues `lanes` to continue at `pc`. Lanes that reached the end of the program are done.
+void LaneVM::schedule(int pc, unsigned lanes) {
+    if (pc >= executable->program.size()) return;
+    for (int i = 0; i < num_waiting; i++) {
+        if (waiting[i].pc == pc) {
+            waiting[i].lanes |= lanes;
+            return;
+        }
+    }
+    waiting[num_waiting++] = { pc, lanes };
+    if (pc < barrier) barrier = pc;
+}
+
+// Makes the waiting group with the lowest pc the active one and returns its pc, or the end of
+// the program when nothing is left to run.
+int LaneVM::pick() {
+    if (num_waiting == 0) {
+        activate(0);
+        return executable->program.size();
+    }
+    int best = 0;
+    for (int i = 1; i < num_waiting; i++) if (waiting[i].pc < waiting[best].pc) best = i;
+    Group group = waiting[best];
+    waiting[best] = waiting[--num_waiting];
+    barrier = INT_MAX;
+    for (int i = 0; i < num_waiting; i++) if (waiting[i].pc < barrier) barrier = waiting[i].pc;
+    activate(group.lanes);
+    return group.pc;
+}
+
+// The active group reached the pc of a waiting one: run them together from here.
+void LaneVM::merge() {
+    unsigned lanes = active;
+    int pc = barrier;
+    for (int i = 0; i < num_waiting; i++) {
+        if (waiting[i].pc == pc) {
+            waiting[i].lanes |= lanes;
+            break;
+        }
+    }
+    this->pick();
+}
+
+int LaneVM::branch(unsigned taken, int target, int next) {
+    taken &= active;
+    unsigned fall = active & ~taken;
+    if (fall == 0) return target;
+    if (taken == 0) return next;
+    this->schedule(target, taken);
+    this->schedule(next, fall);
+    return this->pick();
+}
+
+// There is no vector integer division; divide lane by lane, only where the lane is active, so
+// an inactive lane's stale divisor cannot trap. False, with nothing written, when an active lane
+// divides by zero or INT_MIN by -1; the group then runs on the scalar SVM, which reports it.
+bool LaneVM::divide(Lanes* sp) {
+    int a[LANES], b[LANES];
+    lanes::store(a, sp[-2]);
+    lanes::store(b, sp[-1]);
+    for (int i = 0; i < LANES; i++) {
+        if ((active >> i & 1) && (b[i] == 0 || (b[i] == -1 && a[i] == INT_MIN))) return false;
+    }
+    for (int i = 0; i < LANES; i++) if (active >> i & 1) a[i] /= b[i];
+    sp[-2] = lanes::load(a);
+    return true;
+}
+
+// Appends a print of the top `depth` slots plus the initial stack to the output of each lane in
+// `lanes`, in the format of SVM::print_stack().
+void LaneVM::print(unsigned lanes, int depth, const BatchInput* inputs, std::string* outputs) {
+    std::vector<int> values(depth * LANES);
+    for (int k = 0; k < depth; k++) lanes::store(&values[k * LANES], slots[k]);
+    for (int lane = 0; lane < LANES; lane++) {
+        if (!(lanes >> lane & 1)) continue;
+        std::string& out = outputs[lane];
+        out += "stack [ ";
+        for (int k = depth - 1; k >= 0; k--) out += std::to_string(values[k * LANES + lane]) + " ";
+        const std::vector<int>& entry = inputs[lane].stack;
+        for (size_t k = entry.size(); k-- > 0;) out += std::to_string(entry[k]) + " ";
+        out += "]\n";
+    }
+}
+
+void LaneVM::run_scalar(const BatchInput* inputs, int count, std::string* outputs) {
+    SVM svm(executable);
+    for (int lane = 0; lane < count; lane++) {
+        std::ostringstream buffer;
+        svm.set_output(buffer);
+        svm.reset(inputs[lane].registers, inputs[lane].stack);
+        Status status = svm.execute();
+        if (status.ok()) svm.print_stack();
+        else buffer << "error: " << status.message << std::endl;
+        outputs[lane] = buffer.str();
+    }
+}
+
+// Runs inputs[0, count) with count <= LANES and sets each outputs[i] to what run_batch() would
+// produce for inputs[i]. Lanes need equal initial stack depths, since slot k is shared by all of
+// them; a group that differs runs on the scalar SVM instead.
+void LaneVM::run(const BatchInput* inputs, int count, std::string* outputs) {
+    const Executable& exe = *executable;
+    const Op* code = exe.program.data();
+    const int* depth = exe.verification.depth.data();
+    int n = exe.program.size();
+
+    bool uniform = exe.verification.ok;
+    for (int lane = 1; lane < count; lane++) uniform = uniform && inputs[lane].stack.size() == inputs[0].stack.size();
+    if (!uniform) {
+        this->run_scalar(inputs, count, outputs);
+        return;
+    }
+
+    int values[LANES];
+    for (int r = 0; r < 8; r++) {
+        for (int lane = 0; lane < LANES; lane++) values[lane] = lane < count ? inputs[lane].registers[r] : 0;
+        registers[r] = lanes::load(values);
+    }
+    for (int lane = 0; lane < count; lane++) outputs[lane].clear();
+
+    num_waiting = 0;
+    barrier = INT_MAX;
+    this->activate(count == LANES ? lanes::ALL : (1u << count) - 1);
+    int pc = 0, reg;
+    unsigned taken;
+    Lanes* sp = slots.data();
+
+#define LANE_WRITE(slot, value) slot = lanes::select(active_mask, value, slot)
+#define LANE_JUMP(target) \
+    pc = (target); \
+    sp = slots.data() + depth[pc];
+
+    while (true) {
+        if (pc == barrier) {
+            this->merge();
+            sp = slots.data() + depth[pc];
+        }
+        const Op& op = code[pc];
+        vector_instructions++;
+        lane_instructions += __builtin_popcount(active);
+        switch (op.opcode) {
+            case Instruction::IPUSH: LANE_WRITE(sp[0], lanes::broadcast(op.operand)); sp++; pc++; break;
+            case Instruction::IPOP: sp--; pc++; break;
+            case Instruction::IDUP: LANE_WRITE(sp[0], sp[-1]); sp++; pc++; break;
+            case Instruction::ISWAP: {
+                Lanes top = sp[-1];
+                LANE_WRITE(sp[-1], sp[-2]);
+                LANE_WRITE(sp[-2], top);
+                pc++;
+                break;
+            }
+            case Instruction::IADD: LANE_WRITE(sp[-2], lanes::add(sp[-2], sp[-1])); sp--; pc++; break;
+            case Instruction::ISUB: LANE_WRITE(sp[-2], lanes::sub(sp[-2], sp[-1])); sp--; pc++; break;
+            case Instruction::IMUL: LANE_WRITE(sp[-2], lanes::mul(sp[-2], sp[-1])); sp--; pc++; break;
+            case Instruction::IDIV:
+                if (!this->divide(sp)) {
+                    this->run_scalar(inputs, count, outputs);
+                    return;
+                }
+                sp--;
+                pc++;
+                break;
+            case Instruction::IGOTO: LANE_JUMP(op.operand); break;
+            case Instruction::IJMPEQ: case Instruction::IJMPGT: case Instruction::IJMPGE:
+            case Instruction::IJMPLT: case Instruction::IJMPLE:
+                taken = lanes::compare(op.opcode, sp[-2], sp[-1]);
+                LANE_JUMP(this->branch(taken, op.operand, pc + 1));
+                break;
+            case Instruction::ISKIP: pc++; break;
+            case Instruction::ISTORE: LANE_WRITE(registers[op.operand], sp[-1]); sp--; pc++; break;
+            case Instruction::ILOAD: LANE_WRITE(sp[0], registers[op.operand]); sp++; pc++; break;
+            case Instruction::IPRINT: this->print(active, sp - slots.data(), inputs, outputs); pc++; break;
+            case OP_ADDI: LANE_WRITE(sp[-1], lanes::add(sp[-1], lanes::broadcast(op.operand))); pc++; break;
+            case OP_SUBI: LANE_WRITE(sp[-1], lanes::sub(sp[-1], lanes::broadcast(op.operand))); pc++; break;
+            case OP_MULI: LANE_WRITE(sp[-1], lanes::mul(sp[-1], lanes::broadcast(op.operand))); pc++; break;
+            case OP_DUPSUBI: LANE_WRITE(sp[0], lanes::sub(sp[-1], lanes::broadcast(op.operand))); sp++; pc++; break;
+            case OP_LOADADD: LANE_WRITE(sp[-1], lanes::add(sp[-1], registers[op.operand])); pc++; break;
+            case OP_TEE: LANE_WRITE(registers[op.operand], sp[-1]); pc++; break;
+            case OP_LOAD_JMPEQ: case OP_LOAD_JMPGT: case OP_LOAD_JMPGE: case OP_LOAD_JMPLT: case OP_LOAD_JMPLE:
+                reg = code[pc + 1].opcode;
+                taken = lanes::compare(op.opcode, registers[reg], lanes::broadcast(code[pc + 1].operand));
+                LANE_JUMP(this->branch(taken, op.operand, pc + 2));
+                break;
+            case OP_HALT:
+                vector_instructions--;
+                lane_instructions -= __builtin_popcount(active);
+                LANE_JUMP(this->pick());
+                if (pc < n) break;
+                this->print(count == LANES ? lanes::ALL : (1u << count) - 1, depth[n], inputs, outputs);
+                return;
+            default:
+                this->run_scalar(inputs, count, outputs);
+                return;
+        }
+    }
+#undef LANE_WRITE
+#undef LANE_JUMP
+}
+
+// run_batch() with SVM_LANES inputs per vector run: the pool hands out groups of consecutive
+// inputs, and each worker owns one LaneVM. Adds the lane-instructions executed to `*executed`.
+std::vector<std::string> run_batch_lanes(std::shared_ptr<Executable> executable, const std::vector<BatchInput>& inputs,
+                                         WorkStealingPool& pool, long long* executed) {
+    std::vector<std::string> outputs(inputs.size());
+    std::vector<std::unique_ptr<LaneVM>> machines;
+    for (int w = 0; w < pool.size(); w++) machines.emplace_back(new LaneVM(executable));
+
+    size_t groups = (inputs.size() + LaneVM::LANES - 1) / LaneVM::LANES;
+    pool.parallel_for(groups, [&](size_t g, int worker) {
+        size_t first = g * LaneVM::LANES;
+        int count = std::min<size_t>(LaneVM::LANES, inputs.size() - first);
+        machines[worker]->run(&inputs[first], count, &outputs[first]);
+    });
+    if (executed) {
+        for (std::unique_ptr<LaneVM>& machine : machines) *executed += machine->lane_instructions_executed();
+    }
+    return outputs;
+}
@@ -1,37 +1,177 @@
+#include <chrono>
+#include <csignal>
 #include <fstream>
-#include <sstream>
-#include "../include/parser.h"
+#include "../include/engine.h"
+#include "../include/image.h"
+#include "../include/incremental.h"
+#include "../include/lanes.h"
+#include "../include/optimizer.h"
+#include "../include/parallel_parser.h"
+#include "../include/scheduler.h"
+#include "../include/server.h"
+#include "../include/trace.h"
+#include "../include/transpiler.h"
 
 void test_only_instruction() {
-    SVM* svm;
-
-    std::list<Instruction*> sl;
+    Engine engine;
 
-    sl.push_back(new Instruction("",Instruction::IPUSH, 30));
-    sl.push_back(new Instruction("",Instruction::IPUSH, 3));
-    sl.push_back(new Instruction("",Instruction::IDIV));
-    sl.push_back(new Instruction("",Instruction::IDUP));
-    sl.push_back(new Instruction("",Instruction::IPUSH, 2));  
-    sl.push_back(new Instruction("",Instruction::IADD));
-    sl.push_back(new Instruction("",Instruction::ISWAP));
-    sl.push_back(new Instruction("",Instruction::IJMPGE,"L20"));
-    sl.push_back(new Instruction("",Instruction::IPUSH, 10));		  
-    sl.push_back(new Instruction("",Instruction::IGOTO, "LEND"));
-    sl.push_back(new Instruction("L20",Instruction::IPUSH, 20));
-    sl.push_back(new Instruction("LEND",Instruction::ISKIP));
+    const char* source =
+        "push 30\n"
+        "push 3\n"
+        "div\n"
+        "dup\n"
+        "push 2\n"
+        "add\n"
+        "swap\n"
+        "jmpge L20\n"
+        "push 10\n"
+        "goto LEND\n"
+        "L20: push 20\n"
+        "LEND: skip\n";
 
-    svm = new SVM(sl);
+    Status status = engine.compile(source);
+    if (!status.ok()) {
+        std::cout << status.message << std::endl;
+        return;
+    }
 
     std::cout << "Program:" << std::endl;
-    svm->print();
+    engine.machine().print();
     std::cout << "----------------" << std::endl;
 
     
     std::cout << "Running ...." << std::endl;
-    svm->execute();
+    status = engine.run(std::cout);
+    if (!status.ok()) {
+        std::cout << "error: " << status.message << std::endl;
+        return;
+    }
     std::cout << "Finished" << std::endl;
 
-    svm->print_stack();
+    engine.machine().print_stack();
+}
+
+Status load_program(const char* path, bool stream, int parse_threads, Program& program) {
+    if (stream) {
+        std::ifstream t(path, std::ios::binary);
+        if (!t) return Status(Status::IO_ERROR, "Unable to open file " + std::string(path));
+        Scanner scanner(t);
+        Parser parser(&scanner);
+        return parser.parseProgram(program);
+    }
+
+    std::unique_ptr<MappedFile> file(new MappedFile(path));
+    if (!file->is_open()) return Status(Status::IO_ERROR, "Unable to open file " + std::string(path));
+    if (image::is_image(file->view())) return load_image(std::move(file), program);
+    if (parse_threads > 0) {
+        WorkStealingPool pool(parse_threads);
+        ParallelParser parser(file->view(), pool);
+        Status status = parser.parseProgram(program);
+        if (status.ok() && !parser.duplicates().empty()) {
+            std::cout << "Labels defined more than once, the last definition is used:";
+            for (const std::string& name : parser.duplicates()) std::cout << " " << name;
+            std::cout << std::endl;
+        }
+        return status;
+    }
+
+    Scanner scanner(file->view());
+    Parser parser(&scanner);
+    return parser.parseProgram(program);
+}
+
+Server* running_server = nullptr;
+
+void stop_server(int) {
+    if (running_server) running_server->stop();
+}
+
+// --serve: answers requests on a Unix socket until SIGINT or SIGTERM.
+int serve(const char* socket_path, size_t cache_entries, size_t cache_mb, int threads, const TaskLimits& limits) {
+    ProgramCache cache(cache_entries, cache_mb << 20);
+    Server server(cache, threads, limits);
+    Status status = server.listen(socket_path);
+    if (!status.ok()) {
+        std::cout << status.message << std::endl;
+        return 1;
+    }
+    running_server = &server;
+    std::signal(SIGINT, stop_server);
+    std::signal(SIGTERM, stop_server);
+    std::cout << "Listening on " << socket_path << " with " << threads << " threads, cache of " << cache_entries
+              << " programs / " << cache_mb << " MB" << std::endl;
+    server.serve();
+    running_server = nullptr;
+
+    CacheStats stats = cache.stats();
+    std::cout << "Stopped: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions
+              << " evictions" << std::endl;
+    return 0;
+}
+
+std::vector<std::string_view> split_lines(std::string_view text) {
+    std::vector<std::string_view> lines;
+    size_t start = 0;
+    for (size_t at = text.find('\n'); at != std::string_view::npos; at = text.find('\n', at + 1)) {
+        lines.push_back(text.substr(start, at + 1 - start));
+        start = at + 1;
+    }
+    lines.push_back(text.substr(start));
+    return lines;
+}
+
+bool read_source(const char* path, std::string& text) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// --watch: runs the program, then again every time the file changes. The new text is compared
+// with the old by their common leading and trailing lines, and the lines in between go to the
+// IncrementalCompiler as one edit. Each run gets its own SVM, so between runs the compiler is
+// the only holder of the Executable and patches it in place.
+int watch(const char* path, size_t output_buffer, bool binary_output) {
+    std::string text, changed;
+    if (!read_source(path, text)) {
+        std::cout << "Unable to open file " << path << std::endl;
+        return 1;
+    }
+    IncrementalCompiler compiler;
+    Status status = compiler.compile(text);
+    OutputSink output(std::cout, output_buffer, binary_output ? OutputSink::BINARY : OutputSink::TEXT);
+    while (true) {
+        if (!status.ok()) {
+            std::cout << status.message << std::endl;
+        } else {
+            SVM svm(compiler.executable());
+            svm.set_output(output);
+            std::cout << "Running ...." << std::endl;
+            status = svm.execute();
+            if (!status.ok()) std::cout << "error: " << status.message << std::endl;
+            else std::cout << "Finished" << std::endl;
+            if (status.ok()) svm.print_stack();
+        }
+        std::cout << "Watching " << path << " for changes" << std::endl;
+        do std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        while (!read_source(path, changed) || changed == text);
+
+        std::vector<std::string_view> before = split_lines(text), after = split_lines(changed);
+        size_t front = 0, back = 0;
+        while (front < before.size() && front < after.size() && before[front] == after[front]) front++;
+        while (back < before.size() - front && back < after.size() - front &&
+               before[before.size() - 1 - back] == after[after.size() - 1 - back])
+            back++;
+        size_t from = front < after.size() ? after[front].data() - changed.data() : changed.size();
+        size_t to = after.size() - back < after.size() ? after[after.size() - back].data() - changed.data() : changed.size();
+
+        auto start = std::chrono::steady_clock::now();
+        status = compiler.update(front, before.size() - front - back, std::string_view(changed).substr(from, to - from));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Reloaded lines " << front + 1 << "-" << before.size() - back << " as "
+                  << after.size() - back - front << " lines in " << seconds * 1000 << " ms" << std::endl;
+        text.swap(changed);
+    }
 }
 
 int main(int argc, char** argv) {
@@ -39,27 +179,222 @@ int main(int argc, char** argv) {
 
     SVM* svm;
 
-    if (argc != 2) {
+    bool stream = false, stats = false, use_jit = false, use_registers = false, use_lanes = false;
+    bool parallel_parse = false, profiling = false, binary_output = false;
+    size_t output_buffer = 64 * 1024;
+    int level = 0;
+    const char* path = nullptr;
+    const char* compile_to = nullptr;
+    const char* emit_to = nullptr;
+    const char* batch_from = nullptr;
+    const char* profile_to = nullptr;
+    const char* serve_at = nullptr;
+    const char* trace_to = nullptr;
+    const char* inspect = nullptr;
+    const char* watch_path = nullptr;
+    long long step = -1;
+    size_t cache_entries = 1024, cache_mb = 256;
+    long long request_limit = 100000000;
+    long long quantum = 0;
+    TaskLimits limits = TaskLimits();
+    int threads = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stream") stream = true;
+        else if (arg == "--stats") stats = true;
+        else if (arg == "--jit") use_jit = true;
+        else if (arg == "--regvm") use_registers = true;
+        else if (arg == "--simd") use_lanes = true;
+        else if (arg == "--parallel-parse") parallel_parse = true;
+        else if (arg == "--profile") profiling = true;
+        else if (arg == "--profile-json" && i + 1 < argc) profiling = true, profile_to = argv[++i];
+        else if (arg == "-O0") level = 0;
+        else if (arg == "-O1") level = 1;
+        else if (arg == "-O2") level = 2;
+        else if (arg == "--compile" && i + 1 < argc) compile_to = argv[++i];
+        else if (arg == "--emit-cpp" && i + 1 < argc) emit_to = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc) batch_from = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) threads = std::stoi(argv[++i]);
+        else if (arg == "--quantum" && i + 1 < argc) quantum = std::stoll(argv[++i]);
+        else if (arg == "--max-instructions" && i + 1 < argc) limits.max_instructions = std::stoll(argv[++i]);
+        else if (arg == "--timeout" && i + 1 < argc) limits.timeout_seconds = std::stod(argv[++i]);
+        else if (arg == "--serve" && i + 1 < argc) serve_at = argv[++i];
+        else if (arg == "--trace" && i + 1 < argc) trace_to = argv[++i];
+        else if (arg == "--output-buffer" && i + 1 < argc) output_buffer = std::stoul(argv[++i]);
+        else if (arg == "--binary-output") binary_output = true;
+        else if (arg == "--inspect" && i + 1 < argc) inspect = argv[++i];
+        else if (arg == "--watch" && i + 1 < argc) watch_path = argv[++i];
+        else if (arg == "--step" && i + 1 < argc) step = std::stoll(argv[++i]);
+        else if (arg == "--cache-entries" && i + 1 < argc) cache_entries = std::stoul(argv[++i]);
+        else if (arg == "--cache-mb" && i + 1 < argc) cache_mb = std::stoul(argv[++i]);
+        else if (arg == "--request-limit" && i + 1 < argc) request_limit = std::stoll(argv[++i]);
+        else path = argv[i];
+    }
+    if (serve_at) return serve(serve_at, cache_entries, cache_mb, threads, { request_limit, limits.timeout_seconds });
+    if (watch_path) return watch(watch_path, output_buffer, binary_output);
+    if (!path) {
         std::cout << "File name missing" << std::endl;
-        exit(1);
+        return 1;
+    }
+    std::cout << "Reading program from file " << path << std::endl;
+
+    Program program;
+    Status status = load_program(path, stream, parallel_parse ? threads : 0, program);
+    if (!status.ok()) {
+        std::cout << status.message << std::endl;
+        return status.code == Status::IO_ERROR ? 1 : 0;
+    }
+    OptimizeStats optimize_stats;
+    program = optimize(std::move(program), level, &optimize_stats);
+    if (level > 0) {
+        std::cout << "Optimized: folded " << optimize_stats.folded << " instructions, removed "
+                  << optimize_stats.dead_blocks << " dead blocks, fused " << optimize_stats.fused << " patterns, "
+                  << optimize_stats.before << " -> " << optimize_stats.after << " code words" << std::endl;
+    }
+
+    if (inspect) {
+        status = inspect_trace(program, inspect, step, std::cout);
+        if (!status.ok()) std::cout << status.message << std::endl;
+        return status.ok() ? 0 : 1;
+    }
+    if (compile_to) {
+        status = write_image(program, compile_to, true);
+        if (!status.ok()) {
+            std::cout << status.message << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << program.size() << " instructions to " << compile_to << std::endl;
+        return 0;
+    }
+    if (emit_to) {
+        std::ofstream out(emit_to);
+        status = emit_cpp(program, out);
+        if (!status.ok()) {
+            std::cout << status.message << std::endl;
+            return 0;
+        }
+        std::cout << "Wrote C++ for " << program.size() << " instructions to " << emit_to << std::endl;
+        return 0;
+    }
+    if (batch_from) {
+        std::ifstream in(batch_from);
+        if (!in) {
+            std::cout << "Cannot open batch inputs " << batch_from << std::endl;
+            return 0;
+        }
+        std::vector<BatchInput> inputs;
+        status = read_batch_inputs(in, inputs);
+        if (!status.ok()) {
+            std::cout << status.message << std::endl;
+            return 0;
+        }
+        std::shared_ptr<Executable> executable = std::make_shared<Executable>(std::move(program));
+        if (!executable->verification.ok) {
+            std::cout << "Batch mode needs a program that passes verification: "
+                      << executable->verification.error << std::endl;
+            return 0;
+        }
+        if (use_jit && !executable->enable_jit()) std::cout << "JIT unavailable, interpreting" << std::endl;
+
+        // Limits need the time-sliced scheduler; so does a requested quantum.
+        if (quantum > 0 || limits.max_instructions > 0 || limits.timeout_seconds > 0) {
+            if (quantum <= 0) quantum = 10000;
+            Scheduler scheduler(threads, quantum);
+            auto start = std::chrono::steady_clock::now();
+            for (const BatchInput& input : inputs) scheduler.submit(executable, input, limits);
+            scheduler.run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            for (size_t i = 0; i < scheduler.size(); i++) std::cout << "input " << i << ": " << scheduler.result(i).output;
+            std::cout << "Ran " << inputs.size() << " inputs on " << std::max(threads, 1) << " threads in slices of "
+                      << quantum << " instructions in " << seconds << " s" << std::endl;
+            return 0;
+        }
+
+        WorkStealingPool pool(threads);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> outputs = use_lanes ? run_batch_lanes(executable, inputs, pool)
+                                                     : run_batch(executable, inputs, pool);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (size_t i = 0; i < outputs.size(); i++) std::cout << "input " << i << ": " << outputs[i];
+        std::cout << "Ran " << inputs.size() << " inputs on " << pool.size() << " threads";
+        if (use_lanes) std::cout << " in groups of " << LaneVM::LANES << " lanes";
+        std::cout << " in " << seconds << " s" << std::endl;
+        return 0;
+    }
+    svm = new SVM(std::move(program));
+    OutputSink output(std::cout, output_buffer, binary_output ? OutputSink::BINARY : OutputSink::TEXT);
+    svm->set_output(output);
+    svm->count_instructions(stats);
+    svm->profile_execution(profiling);
+    Trace trace;
+    if (trace_to && !svm->trace_to(&trace)) {
+        std::cout << "Tracing was compiled out (SVM_TRACE=OFF)" << std::endl;
+        trace_to = nullptr;
+    }
+    if (trace_to) {
+        status = trace.open(trace_to);
+        if (!status.ok()) {
+            std::cout << status.message << std::endl;
+            return 1;
+        }
+        if (profiling || use_jit || use_registers) {
+            std::cout << "Tracing runs the interpreter without the profiler" << std::endl;
+            profiling = use_jit = use_registers = false;
+            svm->profile_execution(false);
+        }
+    }
+    if (profiling && (use_jit || use_registers)) {
+        std::cout << "Profiling runs the interpreter" << std::endl;
+        use_registers = false;
+    }
+    if (use_jit && !svm->enable_jit()) std::cout << "JIT unavailable, interpreting" << std::endl;
+    if (use_registers && !svm->enable_register_vm()) {
+        std::cout << "Register VM unavailable, interpreting" << std::endl;
+        use_registers = false;
     }
-    std::cout << "Reading program from file " << argv[1] << std::endl;
-    std::ifstream t(argv[1]);
-    std::stringstream buffer;
-    buffer << t.rdbuf();
-    Scanner scanner(buffer.str());
-    Parser parser(&scanner);
-    svm = parser.parse();
 
     std::cout << "Program:" << std::endl;
     svm->print();
     std::cout << "----------------" << std::endl;
+    if (use_registers) {
+        std::cout << "Register IR:" << std::endl;
+        svm->print_registers();
+        std::cout << "----------------" << std::endl;
+    }
 
     std::cout << "Running ...." << std::endl;
-    svm->execute();
+    status = use_registers ? svm->execute_registers() : svm->execute();
+    if (trace_to) {
+        Status written = trace.close();
+        if (!written.ok()) std::cout << written.message << std::endl;
+        else std::cout << "Wrote trace to " << trace_to << std::endl;
+    }
+    if (!status.ok()) {
+        std::cout << "error: " << status.message << std::endl;
+        return 0;
+    }
     std::cout << "Finished" << std::endl;
 
     svm->print_stack();
+
+    if (stats && use_registers) {
+        std::cout << "Executed " << svm->instructions_dispatched() << " register instructions" << std::endl;
+    } else if (stats) {
+        long long dispatched = svm->instructions_dispatched(), source = svm->source_instructions_executed();
+        std::cout << "Executed " << dispatched << " instructions (" << source << " source instructions, "
+                  << source - dispatched << " saved)" << std::endl;
+    }
+
+    if (profiling) {
+        std::string json_path = profile_to ? profile_to : std::string(path) + ".profile.json";
+        print_profile(svm->program(), *svm->execution_profile(), std::cout);
+        std::ofstream json(json_path);
+        write_profile_json(svm->program(), *svm->execution_profile(), path, json);
+        std::cout << "Wrote profile to " << json_path << std::endl;
+    }
     
     return 0;
 }
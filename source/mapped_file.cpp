@@ -0,0 +1,40 @@
+#include "../include/mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path): data(nullptr), length(0), opened(false) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        opened = true;
+        length = st.st_size;
+        if (length > 0) {
+            void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                opened = false;
+                length = 0;
+            } else {
+                data = static_cast<const char*>(addr);
+                madvise(addr, length, MADV_SEQUENTIAL);
+            }
+        }
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() { this->close(); }
+
+bool MappedFile::is_open() const { return opened; }
+std::string_view MappedFile::view() const { return std::string_view(data, length); }
+
+void MappedFile::close() {
+    if (data) munmap(const_cast<char*>(data), length);
+    data = nullptr;
+    length = 0;
+    opened = false;
+}
+
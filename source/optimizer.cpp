@@ -0,0 +1,326 @@
+#include <climits>
+#include "../include/optimizer.h"
+
+struct BasicBlock {
+    int start, end;
+    std::vector<Op> body;
+    Op exit, exit_operand;
+    bool has_exit, falls_through, reachable;
+};
+
+namespace folding {
+
+bool evaluate(uint32_t opcode, int a, int b, int& result) {
+    unsigned x = static_cast<unsigned>(a), y = static_cast<unsigned>(b);
+    switch (opcode) {
+        case Instruction::IADD: result = static_cast<int>(x + y); return true;
+        case Instruction::ISUB: result = static_cast<int>(x - y); return true;
+        case Instruction::IMUL: result = static_cast<int>(x * y); return true;
+        case Instruction::IDIV:
+            if (b == 0 || (a == INT_MIN && b == -1)) return false;
+            result = a / b;
+            return true;
+    }
+    return false;
+}
+
+bool compare(uint32_t opcode, int next, int top) {
+    switch (opcode) {
+        case Instruction::IJMPEQ: return next == top;
+        case Instruction::IJMPGT: return next > top;
+        case Instruction::IJMPGE: return next >= top;
+        case Instruction::IJMPLT: return next < top;
+        default: return next <= top;
+    }
+}
+
+// Symbolically executes one block. Constants pushed inside the block stay on a virtual stack
+// above the real one and are only materialized when an instruction needs the values below them.
+// Register contents are tracked from stores within the block; nothing is assumed on entry.
+void fold_block(const Op* code, BasicBlock& block, int& folded) {
+    std::vector<int> constants;
+    int known[8];
+    bool is_known[8] = { false };
+
+    auto flush = [&]() {
+        for (int value : constants) block.body.push_back(Op{ Instruction::IPUSH, value });
+        constants.clear();
+    };
+
+    for (int pc = block.start; pc < block.end; pc += op_info[code[pc].opcode].words) {
+        const Op& op = code[pc];
+        size_t count = constants.size();
+        int value;
+
+        switch (op.opcode) {
+            case Instruction::IPUSH:
+                constants.push_back(op.operand);
+                continue;
+            case Instruction::IPOP:
+                if (count >= 1) { constants.pop_back(); folded++; continue; }
+                break;
+            case Instruction::IDUP:
+                if (count >= 1) { constants.push_back(constants.back()); folded++; continue; }
+                break;
+            case Instruction::ISWAP:
+                if (count >= 2) { std::swap(constants[count - 1], constants[count - 2]); folded++; continue; }
+                break;
+            case Instruction::IADD: case Instruction::ISUB: case Instruction::IMUL: case Instruction::IDIV:
+                if (count >= 2 && evaluate(op.opcode, constants[count - 2], constants[count - 1], value)) {
+                    constants.pop_back();
+                    constants.back() = value;
+                    folded++;
+                    continue;
+                }
+                break;
+            case Instruction::ISKIP:
+                continue;
+            case Instruction::ISTORE:
+                if (count >= 1) {
+                    block.body.push_back(Op{ Instruction::IPUSH, constants.back() });
+                    block.body.push_back(op);
+                    known[op.operand] = constants.back();
+                    is_known[op.operand] = true;
+                    constants.pop_back();
+                    continue;
+                }
+                flush();
+                block.body.push_back(op);
+                is_known[op.operand] = false;
+                continue;
+            case Instruction::ILOAD:
+                if (is_known[op.operand]) { constants.push_back(known[op.operand]); folded++; continue; }
+                break;
+            case Instruction::IJMPEQ: case Instruction::IJMPGT: case Instruction::IJMPGE:
+            case Instruction::IJMPLT: case Instruction::IJMPLE:
+                if (count >= 2) {
+                    bool taken = compare(op.opcode, constants[count - 2], constants[count - 1]);
+                    constants.resize(count - 2);
+                    flush();
+                    block.has_exit = taken;
+                    block.falls_through = !taken;
+                    block.exit = Op{ Instruction::IGOTO, op.operand };
+                    folded++;
+                    return;
+                }
+                break;
+        }
+
+        flush();
+        if (Program::is_jump(op.opcode)) {
+            block.has_exit = true;
+            block.falls_through = op.opcode != Instruction::IGOTO;
+            block.exit = op;
+            if (op_info[op.opcode].words == 2) block.exit_operand = code[pc + 1];
+            return;
+        }
+        for (int w = 0; w < op_info[op.opcode].words; w++) block.body.push_back(code[pc + w]);
+        if (op.opcode > OP_HALT) std::fill(is_known, is_known + 8, false);
+    }
+    flush();
+}
+
+} // namespace folding
+
+// Folds constant stack arithmetic, constant conditional jumps and register reloads inside each
+// basic block, then drops blocks that are no longer reachable from the entry, skips, and gotos
+// to the next block. Blocks start at pc 0, at jump targets, at labels and after every jump.
+// Repeats until the program stops shrinking.
+Program fold_constants(Program&& program, OptimizeStats* stats) {
+    int folded = 0, dead_blocks = 0;
+
+    while (true) {
+        const Op* code = program.data();
+        int n = program.size();
+
+        std::vector<bool> leader(n + 1, false), target(n + 1, false);
+        leader[0] = true;
+        for (int pc = 0; pc < n; pc += op_info[code[pc].opcode].words) {
+            if (!Program::is_jump(code[pc].opcode)) continue;
+            leader[code[pc].operand] = target[code[pc].operand] = true;
+            leader[pc + op_info[code[pc].opcode].words] = true;
+        }
+        for (const std::pair<int, std::string_view>& label : program.debug.labels) leader[label.first] = true;
+
+        std::vector<BasicBlock> blocks;
+        std::vector<int> block_of(n + 1, -1);
+        for (int pc = 0; pc < n; pc += op_info[code[pc].opcode].words) {
+            if (leader[pc]) {
+                if (!blocks.empty()) blocks.back().end = pc;
+                blocks.push_back(BasicBlock{ pc, n, {}, Op{ OP_HALT, 0 }, Op{ 0, 0 }, false, true, false });
+            }
+            block_of[pc] = blocks.size() - 1;
+        }
+
+        for (BasicBlock& block : blocks) folding::fold_block(code, block, folded);
+
+        std::vector<int> worklist;
+        if (!blocks.empty()) {
+            blocks[0].reachable = true;
+            worklist.push_back(0);
+        }
+        while (!worklist.empty()) {
+            int b = worklist.back();
+            worklist.pop_back();
+            int successors[2] = { -1, -1 };
+            if (blocks[b].falls_through && b + 1 < blocks.size()) successors[0] = b + 1;
+            if (blocks[b].has_exit && blocks[b].exit.operand < n) successors[1] = block_of[blocks[b].exit.operand];
+            for (int next : successors) {
+                if (next != -1 && !blocks[next].reachable) {
+                    blocks[next].reachable = true;
+                    worklist.push_back(next);
+                }
+            }
+        }
+
+        std::vector<int> live;
+        for (int b = 0; b < blocks.size(); b++) {
+            if (blocks[b].reachable) live.push_back(b);
+            else dead_blocks++;
+        }
+
+        // Emission order is source order, so an unconditional exit to the next live block is dropped
+        // and an empty jump target at the very end keeps a skip to land on.
+        std::vector<int> remap(n + 1, -1);
+        std::vector<Op> out;
+        for (int i = 0; i < live.size(); i++) {
+            BasicBlock& block = blocks[live[i]];
+            int next_start = i + 1 < live.size() ? blocks[live[i + 1]].start : n;
+            remap[block.start] = out.size();
+
+            bool exit_is_next = block.has_exit && block.exit.opcode == Instruction::IGOTO &&
+                                block.exit.operand == next_start;
+            if (block.body.empty() && (!block.has_exit || exit_is_next) && target[block.start] && i + 1 == live.size())
+                block.body.push_back(Op{ Instruction::ISKIP, 0 });
+
+            out.insert(out.end(), block.body.begin(), block.body.end());
+            if (block.has_exit && !exit_is_next) {
+                out.push_back(block.exit);
+                if (op_info[block.exit.opcode].words == 2) out.push_back(block.exit_operand);
+            }
+        }
+        remap[n] = out.size();
+        out.push_back(Op{ OP_HALT, 0 });
+
+        for (size_t pc = 0; pc + 1 < out.size(); pc += op_info[out[pc].opcode].words) {
+            if (Program::is_jump(out[pc].opcode)) out[pc].operand = remap[out[pc].operand];
+        }
+
+        Program result;
+        result.code = std::move(out);
+        // Labels of instructions folded away land on the next pc; like Parser::resolveLabels(),
+        // the last name for a pc wins, so the table keeps one entry per pc.
+        std::vector<std::pair<int, std::string_view>>& labels = result.debug.labels;
+        for (const std::pair<int, std::string_view>& label : program.debug.labels) {
+            int pc = remap[label.first];
+            if (!blocks[block_of[label.first]].reachable || pc >= result.size()) continue;
+            if (!labels.empty() && labels.back().first == pc) labels.back().second = label.second;
+            else labels.emplace_back(pc, label.second);
+        }
+        result.debug.strings = std::move(program.debug.strings);
+
+        bool shrunk = result.size() < n;
+        program = std::move(result);
+        if (!shrunk) break;
+    }
+
+    if (stats) {
+        stats->folded = folded;
+        stats->dead_blocks = dead_blocks;
+    }
+    return std::move(program);
+}
+
+// Rewrites common idioms into superinstructions:
+//   push K; add|sub|mul        -> addi|subi|multi K
+//   dup; push K; sub           -> dupsubi K
+//   load N; add                -> loadadd N
+//   store N; load N            -> tee N
+//   load N; push K; jmpXX L    -> load_jmpXX L, {N, K}
+// A pattern never swallows a labelled instruction or a jump target past its first position.
+// Jump targets and label definitions are remapped to the compacted code.
+Program peephole(Program&& program, OptimizeStats* stats) {
+    const Op* code = program.data();
+    size_t n = program.size();
+
+    std::vector<bool> boundary(n + 1, false);
+    for (size_t i = 0; i < n; i += op_info[code[i].opcode].words) {
+        if (Program::is_jump(code[i].opcode)) boundary[code[i].operand] = true;
+    }
+    for (const std::pair<int, std::string_view>& label : program.debug.labels) boundary[label.first] = true;
+
+    std::vector<int> remap(n + 1, -1);
+    std::vector<Op> out;
+    out.reserve(n + 1);
+    int fused = 0;
+
+    auto is = [&](size_t i, uint32_t opcode) { return i < n && code[i].opcode == opcode && !boundary[i]; };
+
+    size_t i = 0;
+    while (i < n) {
+        remap[i] = out.size();
+        const Op& op = code[i];
+
+        if (op.opcode == Instruction::ILOAD && is(i + 1, Instruction::IPUSH) && i + 2 < n && !boundary[i + 2] &&
+            code[i + 2].opcode >= Instruction::IJMPEQ && code[i + 2].opcode <= Instruction::IJMPLE) {
+            uint32_t fused_op = OP_LOAD_JMPEQ + (code[i + 2].opcode - Instruction::IJMPEQ);
+            out.push_back(Op{ fused_op, code[i + 2].operand });
+            out.push_back(Op{ static_cast<uint32_t>(op.operand), code[i + 1].operand });
+            i += 3;
+        } else if (op.opcode == Instruction::IDUP && is(i + 1, Instruction::IPUSH) && is(i + 2, Instruction::ISUB)) {
+            out.push_back(Op{ OP_DUPSUBI, code[i + 1].operand });
+            i += 3;
+        } else if (op.opcode == Instruction::IPUSH && is(i + 1, Instruction::IADD)) {
+            out.push_back(Op{ OP_ADDI, op.operand });
+            i += 2;
+        } else if (op.opcode == Instruction::IPUSH && is(i + 1, Instruction::ISUB)) {
+            out.push_back(Op{ OP_SUBI, op.operand });
+            i += 2;
+        } else if (op.opcode == Instruction::IPUSH && is(i + 1, Instruction::IMUL)) {
+            out.push_back(Op{ OP_MULI, op.operand });
+            i += 2;
+        } else if (op.opcode == Instruction::ILOAD && is(i + 1, Instruction::IADD)) {
+            out.push_back(Op{ OP_LOADADD, op.operand });
+            i += 2;
+        } else if (op.opcode == Instruction::ISTORE && is(i + 1, Instruction::ILOAD) && code[i + 1].operand == op.operand) {
+            out.push_back(Op{ OP_TEE, op.operand });
+            i += 2;
+        } else {
+            for (int w = 0; w < op_info[op.opcode].words; w++) out.push_back(code[i + w]);
+            i += op_info[op.opcode].words;
+            continue;
+        }
+        fused++;
+    }
+    remap[n] = out.size();
+    out.push_back(Op{ OP_HALT, 0 });
+
+    for (size_t pc = 0; pc + 1 < out.size(); pc += op_info[out[pc].opcode].words) {
+        if (Program::is_jump(out[pc].opcode)) out[pc].operand = remap[out[pc].operand];
+    }
+
+    Program result;
+    result.code = std::move(out);
+    result.debug.labels = std::move(program.debug.labels);
+    for (std::pair<int, std::string_view>& label : result.debug.labels) label.first = remap[label.first];
+    result.debug.strings = std::move(program.debug.strings);
+
+    if (stats) stats->fused = fused;
+    return result;
+}
+
+// Optimizations assume the program verifies; anything else is returned unchanged so that
+// checked execution still reports the original runtime error. -O1 fuses superinstructions,
+// -O2 folds constants and removes dead code first.
+Program optimize(Program&& program, int level, OptimizeStats* stats) {
+    if (stats) {
+        stats->folded = stats->dead_blocks = stats->fused = 0;
+        stats->before = stats->after = program.size();
+    }
+    if (level <= 0 || !verify(program).ok) return std::move(program);
+
+    if (level >= 2) program = fold_constants(std::move(program), stats);
+    program = peephole(std::move(program), stats);
+    if (stats) stats->after = program.size();
+    return std::move(program);
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include "../include/output.h"
+
+OutputSink::OutputSink(std::ostream& stream, size_t threshold, Format format)
+    : stream(&stream), used(0), capacity(0), threshold(threshold), format(format) {}
+
+OutputSink::~OutputSink() { this->flush(); }
+
+// Output already buffered goes to the old stream first.
+void OutputSink::set_stream(std::ostream& stream) {
+    this->flush();
+    this->stream = &stream;
+}
+
+void OutputSink::set_threshold(size_t threshold) {
+    this->threshold = threshold;
+    if (used >= threshold) this->flush();
+}
+
+void OutputSink::set_format(Format format) { this->format = format; }
+
+std::ostream& OutputSink::target() { return *stream; }
+
+void OutputSink::flush() {
+    if (used == 0) return;
+    stream->write(buffer.get(), used);
+    used = 0;
+}
+
+// Room for `bytes` more at the end of the buffer. Doubles the buffer while it is below the
+// threshold; past it, makes room by flushing instead.
+char* OutputSink::reserve(size_t bytes) {
+    if (used + bytes <= capacity) return buffer.get() + used;
+    if (used > 0 && used >= threshold) this->flush();
+    if (used + bytes > capacity) {
+        size_t size = std::max<size_t>({ 256, capacity * 2, used + bytes });
+        std::unique_ptr<char[]> grown(new char[size]);
+        if (used > 0) std::memcpy(grown.get(), buffer.get(), used);
+        buffer = std::move(grown);
+        capacity = size;
+    }
+    return buffer.get() + used;
+}
+
+// Reads the stack in place, `depth` values upwards from `bottom`, and writes it top first.
+void OutputSink::write_stack(const int* bottom, int depth) {
+    char* start;
+    char* out;
+    if (format == BINARY) {
+        start = out = this->reserve((depth + 1) * sizeof(int32_t));
+        int32_t count = depth;
+        std::memcpy(out, &count, sizeof(count));
+        out += sizeof(count);
+        for (int i = depth - 1; i >= 0; i--, out += sizeof(int32_t)) std::memcpy(out, &bottom[i], sizeof(int32_t));
+    } else {
+        // "-2147483648 " is the longest a value gets.
+        start = out = this->reserve(sizeof("stack [ ]\n") + depth * 12);
+        std::memcpy(out, "stack [ ", 8);
+        out += 8;
+        for (int i = depth - 1; i >= 0; i--) {
+            out = std::to_chars(out, out + 11, bottom[i]).ptr;
+            *out++ = ' ';
+        }
+        *out++ = ']';
+        *out++ = '\n';
+    }
+    used += out - start;
+    if (used >= threshold) this->flush();
+}
+
+void OutputSink::write(std::string_view text) {
+    std::memcpy(this->reserve(text.size()), text.data(), text.size());
+    used += text.size();
+    if (used >= threshold) this->flush();
+}
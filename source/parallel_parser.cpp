@@ -0,0 +1,187 @@
+#include <algorithm>
+#include "../include/parallel_parser.h"
+
+ParallelParser::ParallelParser(std::string_view source, WorkStealingPool& pool, size_t chunk_size)
+    : source(source), pool(pool), chunk_size(chunk_size ? chunk_size : 1) {}
+
+size_t ParallelParser::num_chunks() { return chunks.size(); }
+
+const std::vector<std::string>& ParallelParser::duplicates() { return duplicated; }
+
+// True when the newline just before `cut` is an <eol> token rather than the end of a `%`
+// comment, which the scanner skips together with its newline. The second newline of a run is
+// always <eol>; a lone one is, unless its line holds a `%`.
+bool ParallelParser::ends_eol(size_t cut) {
+    if (cut < 2 || source[cut - 2] == '\n') return true;
+    size_t line = source.rfind('\n', cut - 2);
+    line = line == std::string_view::npos ? 0 : line + 1;
+    return source.substr(line, cut - 1 - line).find('%') == std::string_view::npos;
+}
+
+// True when `text` holds a NUL outside a `%` comment; the scanner treats it as end of input.
+bool ParallelParser::ends_input(std::string_view text) {
+    for (size_t at = text.find('\0'); at != std::string_view::npos; at = text.find('\0', at + 1)) {
+        size_t line = text.rfind('\n', at);
+        line = line == std::string_view::npos ? 0 : line + 1;
+        if (text.substr(line, at - line).find('%') == std::string_view::npos) return true;
+    }
+    return false;
+}
+
+// Every cut follows a whole run of newlines that forms an <eol> token, so the scanner starts
+// each chunk in the state it would be in at that point of the whole text.
+void ParallelParser::split() {
+    chunks.clear();
+    size_t n = source.size(), start = 0;
+    while (start < n) {
+        size_t cut = start + chunk_size, from = cut - 1;
+        while (cut < n) {
+            size_t newline = source.find('\n', from);
+            if (newline == std::string_view::npos) {
+                cut = n;
+                break;
+            }
+            cut = newline + 1;
+            while (cut < n && source[cut] == '\n') cut++;
+            if (cut < n && this->ends_eol(cut)) break;
+            from = cut;
+        }
+        if (cut > n) cut = n;
+        chunks.emplace_back();
+        chunks.back().text = source.substr(start, cut - start);
+        start = cut;
+    }
+}
+
+void ParallelParser::parse_chunk(size_t i) {
+    Chunk& chunk = chunks[i];
+    Scanner scanner(chunk.text);
+    Parser parser(&scanner);
+
+    // The first token of a later chunk is read by advance() in the sequential parser.
+    parser.current = scanner.next_token();
+    if (parser.check(Token::ERR)) {
+        if (i == 0) parser.error("Error: Invalid character");
+        else parser.error("Parse error, unrecognised character: " + std::string(parser.current.lexeme));
+    }
+    if (parser.failure.ok()) parser.parseInstructions();
+
+    chunk.program = std::move(parser.program);
+    chunk.jumps = std::move(parser.jumps);
+    chunk.arena = std::move(parser.arena);
+    chunk.failure = std::move(parser.failure);
+    chunk.truncated = ends_input(chunk.text);
+
+    for (int k = 0; k < chunk.program.size(); k++) {
+        if (chunk.program[k].label != "") chunk.labels.emplace_back(chunk.program[k].label, k);
+    }
+    std::stable_sort(chunk.labels.begin(), chunk.labels.end(),
+                     [](const Definition& a, const Definition& b) { return a.first < b.first; });
+}
+
+// Pairwise merges of the per-chunk tables, one parallel round per level. std::merge keeps
+// equal names from the earlier chunk first, so the table orders every name's definitions by
+// position exactly like the sequential stable sort, including duplicates split across chunks.
+// Definitions of the same name end up adjacent, so one pass over the result finds them.
+std::vector<ParallelParser::Definition> ParallelParser::merge_labels() {
+    std::vector<std::vector<Definition>> tables(chunks.size());
+    pool.parallel_for(chunks.size(), [&](size_t i, int) {
+        tables[i] = std::move(chunks[i].labels);
+        for (Definition& definition : tables[i]) definition.second += chunks[i].offset;
+    });
+
+    while (tables.size() > 1) {
+        std::vector<std::vector<Definition>> merged((tables.size() + 1) / 2);
+        pool.parallel_for(merged.size(), [&](size_t i, int) {
+            if (2 * i + 1 == tables.size()) {
+                merged[i] = std::move(tables[2 * i]);
+                return;
+            }
+            const std::vector<Definition>& a = tables[2 * i];
+            const std::vector<Definition>& b = tables[2 * i + 1];
+            merged[i].resize(a.size() + b.size());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), merged[i].begin(),
+                       [](const Definition& x, const Definition& y) { return x.first < y.first; });
+        });
+        tables.swap(merged);
+    }
+    if (tables.empty()) return std::vector<Definition>();
+    const std::vector<Definition>& labels = tables[0];
+    for (size_t k = 1; k < labels.size(); k++) {
+        if (labels[k].first == labels[k - 1].first && (k == 1 || labels[k - 2].first != labels[k].first))
+            duplicated.emplace_back(labels[k].first);
+    }
+    return std::move(tables[0]);
+}
+
+// Resolves the chunk's jumps, keeping the first missing label, and writes its code words and
+// label entries into their slices of `lowered`.
+void ParallelParser::lower_chunk(size_t i, const std::vector<Definition>& labels, Program& lowered) {
+    Chunk& chunk = chunks[i];
+    for (size_t k : chunk.jumps) {
+        std::string_view name = chunk.program[k].jmp_label;
+        std::vector<Definition>::const_iterator it = std::upper_bound(labels.begin(), labels.end(), name,
+            [](std::string_view key, const Definition& d) { return key < d.first; });
+        if (it == labels.begin() || (it - 1)->first != name) {
+            if (chunk.missing.empty()) chunk.missing = name;
+            continue;
+        }
+        chunk.program[k].argument_int = (it - 1)->second;
+    }
+
+    Op* code = lowered.code.data() + chunk.offset;
+    size_t label = chunk.label_offset;
+    for (int k = 0; k < chunk.program.size(); k++) {
+        const Instruction& instr = chunk.program[k];
+        code[k] = Op{ static_cast<uint32_t>(instr.itype), instr.argument_int };
+        if (instr.label != "") lowered.debug.labels[label++] = std::make_pair(int(chunk.offset + k), instr.label);
+    }
+    std::vector<Instruction>().swap(chunk.program);
+}
+
+// Same contract as Parser::parseProgram(): `out` is replaced on success and untouched on error.
+Status ParallelParser::parseProgram(Program& out) {
+    duplicated.clear();
+    this->split();
+    pool.parallel_for(chunks.size(), [&](size_t i, int) { this->parse_chunk(i); });
+
+    // The sequential parser stops at the first error or at a NUL byte, which ends its input.
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (!chunks[i].failure.ok()) {
+            Status failure = std::move(chunks[i].failure);
+            chunks.clear();
+            return failure;
+        }
+        if (chunks[i].truncated) {
+            chunks.erase(chunks.begin() + i + 1, chunks.end());
+            break;
+        }
+    }
+
+    size_t total = 0, total_labels = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.offset = total;
+        chunk.label_offset = total_labels;
+        total += chunk.program.size();
+        total_labels += chunk.labels.size();
+    }
+    std::vector<Definition> labels = this->merge_labels();
+
+    Program lowered;
+    lowered.code.resize(total + 1);
+    lowered.code[total] = Op{ OP_HALT, 0 };
+    lowered.debug.labels.resize(total_labels);
+    pool.parallel_for(chunks.size(), [&](size_t i, int) { this->lower_chunk(i, labels, lowered); });
+
+    for (Chunk& chunk : chunks) {
+        if (!chunk.missing.empty()) {
+            Status failure(Status::UNKNOWN_LABEL, "No label found: " + std::string(chunk.missing));
+            chunks.clear();
+            return failure;
+        }
+    }
+    for (Chunk& chunk : chunks) lowered.debug.strings.adopt(std::move(chunk.arena));
+    chunks.clear();
+    out = std::move(lowered);
+    return Status();
+}
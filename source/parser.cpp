@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include "../include/parser.h"
+
+bool Parser::isAtEnd() { return (current.type == Token::END); }
+bool Parser::check(Token::Type token_type) { return this->isAtEnd() ? false : current.type == token_type;}
+
+bool Parser::match(Token::Type token_type) {
+    if (this->check(token_type)) {
+        this->advance();
+        return true;
+    }
+    return false;
+}
+
+bool Parser::advance() {
+    if (!this->isAtEnd()) {
+        previous = current;
+        current = scanner->next_token();
+
+        if (this->check(Token::ERR))
+            this->error("Parse error, unrecognised character: " + std::string(current.lexeme));
+        return true;
+    }
+    return false;
+}
+
+// Keeps the first error; parseInstructions() stops at it.
+void Parser::error(const std::string& msg, Status::Code code) {
+    if (failure.ok()) failure = Status(code, msg);
+}
+
+void Parser::parseInstruction() {
+    std::string_view label, jmp_label;
+    Token::Type token_type;
+    int argument_int;
+    int type_instr = 0;
+
+    if (this->check(Token::LABEL)) {
+        label = arena.copy(current.lexeme);
+        this->advance();
+    }
+
+    if (this->match(Token::POP) || this->match(Token::ADD) || this->match(Token::SUB) ||
+        this->match(Token::MUL) || this->match(Token::DIV) || this->match(Token::SKIP) ||
+        this->match(Token::DUP) || this->match(Token::SWAP) || this->match(Token::PRINT)) {
+        type_instr = 0;
+        token_type = previous.type;
+    } else if (this->match(Token::PUSH) || this->match(Token::STORE) || this->match(Token::LOAD)) {
+        type_instr = 1;
+        token_type = previous.type;
+    } else if (this->match(Token::GOTO) || this->match(Token::JMPEQ) ||
+               this->match(Token::JMPGT) || this->match(Token::JMPGE) ||
+               this->match(Token::JMPLT) || this->match(Token::JMPLE)) {
+        type_instr = 2;
+        token_type = previous.type;
+    } else {
+        std::ostringstream msg;
+        msg << "Error: couldn't find a match for " << current;
+        this->error(msg.str());
+        return;
+    }
+
+    if (type_instr == 1) {
+        if (!this->check(Token::NUM)) {
+            this->error("Error: Expected number");
+            return;
+        }
+        const char* last = current.lexeme.data() + current.lexeme.size();
+        if (std::from_chars(current.lexeme.data(), last, argument_int).ec != std::errc()) {
+            this->error("Error: Number out of range");
+            return;
+        }
+        this->advance();
+    } else if (type_instr == 2) {
+        if (!this->check(Token::ID)) {
+            this->error("Error: Expected id");
+            return;
+        }
+        jmp_label = arena.copy(current.lexeme);
+        this->advance();
+    }
+
+    if (!this->match(Token::EOL)) {
+        this->error("Error: Expected end of line");
+        return;
+    }
+
+    Instruction::IType itype;
+    if (!Token::tokenToIType(token_type, itype)) {
+        this->error("Error: Unknown Keyword type");
+        return;
+    }
+    if(type_instr == 0) {
+        program.emplace_back(label, itype);
+    } else if (type_instr == 1) {
+        program.emplace_back(label, itype, argument_int);
+    } else {
+        jumps.push_back(program.size());
+        program.emplace_back(label, itype, jmp_label);
+    }
+}
+
+// Jump targets may be defined after the jump, so they are patched once the whole program is read.
+// Definitions are sorted by name, then position, so the last definition of a repeated label wins.
+// std::sort rather than std::stable_sort, which allocates a temporary buffer on every call.
+void Parser::resolveLabels() {
+    labels.clear();
+    for (int i = 0; i < program.size(); i++) {
+        if (program[i].label != "") labels.emplace_back(program[i].label, i);
+    }
+    std::sort(labels.begin(), labels.end());
+
+    for (size_t i : jumps) {
+        std::string_view name = program[i].jmp_label;
+        std::vector<Definition>::const_iterator it = std::upper_bound(labels.begin(), labels.end(), name,
+            [](std::string_view key, const Definition& d) { return key < d.first; });
+        if (it == labels.begin() || (it - 1)->first != name) {
+            this->error("No label found: " + std::string(name), Status::UNKNOWN_LABEL);
+            return;
+        }
+        program[i].argument_int = (it - 1)->second;
+    }
+}
+
+// Parses up to the end of input or the first error, leaving jump labels unresolved.
+void Parser::parseInstructions() {
+    program.clear();
+    jumps.clear();
+
+    while (current.type != Token::END && failure.ok()) this->parseInstruction();
+}
+
+Parser::Parser(Scanner* scanner): scanner(scanner) {}
+
+void Parser::reset(Scanner* scanner) {
+    this->scanner = scanner;
+    current = previous = Token();
+    failure = Status();
+}
+
+// Replaces `out` with the parsed program, reusing its code and label storage; `out` is left
+// untouched on error. The arena the old program's labels lived in becomes this parser's scratch
+// arena for the next parse.
+Status Parser::parseProgram(Program& out) {
+    failure = Status();
+    arena.clear();
+    current = scanner->next_token();
+
+    if (this->check(Token::ERR)) this->error("Error: Invalid character");
+    if (failure.ok()) this->parseInstructions();
+    if (failure.ok()) this->resolveLabels();
+    if (!failure.ok()) return failure;
+
+    Arena previous_strings = std::move(out.debug.strings);
+    out.assign(program, std::move(arena));
+    arena = std::move(previous_strings);
+    return failure;
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "../include/profiler.h"
+
+Profile::Profile(size_t size): executed(size, 0), taken(size, 0), peak_depth(0) {}
+
+// A goto has no counter of its own: it is taken every time it runs.
+long long Profile::taken_at(const Program& program, int pc) const {
+    return program.data()[pc].opcode == Instruction::IGOTO ? executed[pc] : taken[pc];
+}
+
+// One line of SVM::print(): optional label, opcode name, the register and constant of a fused
+// compare, then the operand or the name of the jump target.
+std::string listing_line(const Program& program, int pc) {
+    std::ostringstream line;
+    const Op& s = program.data()[pc];
+    std::string_view label = program.debug.label_at(pc);
+
+    if (label != "") line << label << ": ";
+    line << op_info[s.opcode].name << " ";
+    if (s.opcode >= OP_LOAD_JMPEQ && s.opcode <= OP_LOAD_JMPLE) {
+        const Op& ext = program.data()[pc + 1];
+        line << ext.opcode << " " << ext.operand << " ";
+    }
+    if (Program::has_operand(s.opcode)) {
+        std::string_view target = Program::is_jump(s.opcode) ? program.debug.label_at(s.operand) : "";
+        if (target != "") line << target;
+        else line << s.operand;
+    }
+    return line.str();
+}
+
+// Backward jumps that were taken at least once, most iterations first. `instructions` counts
+// every dispatch inside the loop body, nested loops included.
+std::vector<HotLoop> hot_loops(const Program& program, const Profile& profile) {
+    std::vector<HotLoop> loops;
+    const Op* code = program.data();
+    for (int pc = 0; pc < program.size(); pc += op_info[code[pc].opcode].words) {
+        long long taken = profile.taken_at(program, pc);
+        if (!Program::is_jump(code[pc].opcode) || code[pc].operand > pc || taken == 0) continue;
+        HotLoop loop = { code[pc].operand, pc, taken, 0 };
+        for (int i = loop.head; i <= pc; i++) loop.instructions += profile.executed[i];
+        loops.push_back(loop);
+    }
+    std::stable_sort(loops.begin(), loops.end(),
+                     [](const HotLoop& a, const HotLoop& b) { return a.iterations > b.iterations; });
+    return loops;
+}
+
+std::vector<long long> opcode_counts(const Program& program, const Profile& profile) {
+    std::vector<long long> counts(NUM_OPCODES, 0);
+    const Op* code = program.data();
+    for (int pc = 0; pc < program.size(); pc += op_info[code[pc].opcode].words)
+        counts[code[pc].opcode] += profile.executed[pc];
+    return counts;
+}
+
+// The program listing with each line's dispatch count and share of the total, taken/not-taken
+// counts on jumps and the back edges of the hottest loops flagged, followed by loop, opcode and
+// stack summaries.
+void print_profile(const Program& program, const Profile& profile, std::ostream& out, int top) {
+    const Op* code = program.data();
+    long long total = 0;
+    for (long long count : profile.executed) total += count;
+    double scale = total ? 100.0 / total : 0;
+
+    std::vector<HotLoop> loops = hot_loops(program, profile);
+    if (loops.size() > top) loops.resize(top);
+
+    out << std::fixed << std::setprecision(1);
+    out << "Profile:" << std::endl;
+    out << std::setw(14) << "count" << std::setw(8) << "%" << "  code" << std::endl;
+    for (int pc = 0; pc < program.size(); pc += op_info[code[pc].opcode].words) {
+        long long count = profile.executed[pc];
+        std::string line = listing_line(program, pc);
+        out << std::setw(14) << count << std::setw(7) << count * scale << "%  " << line;
+        if (Program::is_jump(code[pc].opcode) && code[pc].opcode != Instruction::IGOTO && count) {
+            out << std::string(line.size() < 24 ? 24 - line.size() : 1, ' ') << "taken " << profile.taken[pc]
+                << ", not taken " << count - profile.taken[pc];
+        }
+        for (int rank = 0; rank < loops.size(); rank++) {
+            if (loops[rank].back_edge == pc) out << "  <== hot loop #" << rank + 1;
+        }
+        out << std::endl;
+    }
+
+    out << "Hot loops:" << std::endl;
+    if (loops.empty()) out << "  none" << std::endl;
+    for (int rank = 0; rank < loops.size(); rank++) {
+        const HotLoop& loop = loops[rank];
+        std::string_view label = program.debug.label_at(loop.head);
+        out << "  #" << rank + 1 << " pc " << loop.head << "-" << loop.back_edge;
+        if (label != "") out << " (" << label << ")";
+        out << ": " << loop.iterations << " iterations, " << loop.instructions << " instructions, "
+            << loop.instructions * scale << "%" << std::endl;
+    }
+
+    std::vector<long long> counts = opcode_counts(program, profile);
+    std::vector<int> order;
+    for (int op = 0; op < NUM_OPCODES; op++) if (counts[op]) order.push_back(op);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return counts[a] > counts[b]; });
+    out << "By opcode:" << std::endl;
+    for (int op : order) {
+        out << std::setw(14) << counts[op] << std::setw(7) << counts[op] * scale << "%  " << op_info[op].name
+            << std::endl;
+    }
+    out << "Executed " << total << " instructions, peak stack depth " << profile.peak_depth << std::endl;
+    out << std::defaultfloat << std::setprecision(6);
+}
+
+void write_json_string(std::string_view text, std::ostream& out) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                                                           << int(c) << std::dec << std::setfill(' ');
+        else out << c;
+    }
+    out << '"';
+}
+
+// The same data for dashboards: totals, per-opcode counts, one record per instruction and the
+// loops ranked by iterations.
+void write_profile_json(const Program& program, const Profile& profile, std::string_view name, std::ostream& out) {
+    const Op* code = program.data();
+    long long total = 0;
+    for (long long count : profile.executed) total += count;
+
+    out << "{\n  \"program\": ";
+    write_json_string(name, out);
+    out << ",\n  \"instructions\": " << total << ",\n  \"peak_depth\": " << profile.peak_depth;
+
+    out << ",\n  \"opcodes\": {";
+    std::vector<long long> counts = opcode_counts(program, profile);
+    bool first = true;
+    for (int op = 0; op < NUM_OPCODES; op++) {
+        if (!counts[op]) continue;
+        out << (first ? "" : ",") << "\n    \"" << op_info[op].name << "\": " << counts[op];
+        first = false;
+    }
+    out << (first ? "}" : "\n  }");
+
+    out << ",\n  \"pcs\": [";
+    first = true;
+    for (int pc = 0; pc < program.size(); pc += op_info[code[pc].opcode].words) {
+        out << (first ? "" : ",") << "\n    {\"pc\": " << pc << ", \"op\": \"" << op_info[code[pc].opcode].name
+            << "\", \"label\": ";
+        write_json_string(program.debug.label_at(pc), out);
+        out << ", \"count\": " << profile.executed[pc];
+        if (Program::is_jump(code[pc].opcode)) {
+            long long taken = profile.taken_at(program, pc);
+            out << ", \"target\": " << code[pc].operand << ", \"taken\": " << taken
+                << ", \"not_taken\": " << profile.executed[pc] - taken;
+        }
+        out << "}";
+        first = false;
+    }
+    out << (first ? "]" : "\n  ]");
+
+    out << ",\n  \"loops\": [";
+    first = true;
+    for (const HotLoop& loop : hot_loops(program, profile)) {
+        out << (first ? "" : ",") << "\n    {\"head\": " << loop.head << ", \"back_edge\": " << loop.back_edge
+            << ", \"label\": ";
+        write_json_string(program.debug.label_at(loop.head), out);
+        out << ", \"iterations\": " << loop.iterations << ", \"instructions\": " << loop.instructions << "}";
+        first = false;
+    }
+    out << (first ? "]" : "\n  ]") << "\n}\n";
+}
+
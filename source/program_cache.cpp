@@ -0,0 +1,85 @@
+#include "../include/program_cache.h"
+#include "../include/image.h"
+#include "../include/optimizer.h"
+#include "../include/parser.h"
+
+ProgramCache::ProgramCache(size_t max_entries, size_t max_bytes)
+    : max_entries(max_entries), max_bytes(max_bytes), bytes(0), hits(0), misses(0), evictions(0) {}
+
+uint64_t ProgramCache::key_of(std::string_view source, int level) {
+    return image::checksum(source.data(), source.size()) ^ static_cast<uint64_t>(level) * 0x9E3779B97F4A7C15ull;
+}
+
+// A parser's arena grows in 64 KB blocks; a cached program keeps its label names in one block of
+// exactly their size instead.
+std::shared_ptr<Executable> ProgramCache::compile(std::string_view source, int level, Status& status) {
+    Scanner scanner(source);
+    Parser parser(&scanner);
+    Program program;
+    status = parser.parseProgram(program);
+    if (!status.ok()) return nullptr;
+    if (level > 0) program = optimize(std::move(program), level);
+
+    size_t names = 0;
+    for (const std::pair<int, std::string_view>& label : program.debug.labels) names += label.second.size();
+    Arena strings(names + 1);
+    for (std::pair<int, std::string_view>& label : program.debug.labels) label.second = strings.copy(label.second);
+    program.debug.strings = std::move(strings);
+    return std::make_shared<Executable>(std::move(program));
+}
+
+void ProgramCache::evict() {
+    while (!entries.empty() && (entries.size() > max_entries || bytes > max_bytes)) {
+        Entry& oldest = entries.back();
+        bytes -= oldest.bytes;
+        index.erase(oldest.key);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+// Sets `out` to the compiled program for `source` at optimization level `level`, compiling and
+// inserting it on a miss. Compile errors are returned and never cached.
+Status ProgramCache::get(std::string_view source, int level, std::shared_ptr<Executable>& out) {
+    uint64_t key = key_of(source, level);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = index.find(key);
+        if (it != index.end() && it->second->level == level && it->second->source == source) {
+            entries.splice(entries.begin(), entries, it->second);
+            hits++;
+            out = it->second->executable;
+            return Status();
+        }
+        misses++;
+    }
+
+    Status status;
+    std::shared_ptr<Executable> executable = compile(source, level, status);
+    if (!executable) return status;
+    const Program& program = executable->program;
+    size_t size = sizeof(Entry) + source.size() + (program.size() + 1) * sizeof(Op) +
+                  executable->verification.depth.size() * sizeof(int) +
+                  program.debug.labels.size() * sizeof(std::pair<int, std::string_view>);
+    for (const std::pair<int, std::string_view>& label : program.debug.labels) size += label.second.size();
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = index.find(key);
+    if (it != index.end()) {
+        // Another thread compiled the same program first, or a colliding one is being replaced.
+        bytes -= it->second->bytes;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    entries.push_front(Entry{ key, level, std::string(source), executable, size });
+    index[key] = entries.begin();
+    bytes += size;
+    this->evict();
+    out = std::move(executable);
+    return Status();
+}
+
+CacheStats ProgramCache::stats() {
+    std::lock_guard<std::mutex> guard(lock);
+    return CacheStats{ hits, misses, evictions, entries.size(), bytes };
+}
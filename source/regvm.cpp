@@ -0,0 +1,410 @@
+#include <climits>
+#include "../include/regvm.h"
+
+const char* reg_names[NUM_REG_OPCODES] = {
+    "halt", "mov", "movi", "add", "sub", "mult", "div", "addi", "subi", "multi", "divi",
+    "goto", "jmpeq", "jmpgt", "jmpge", "jmplt", "jmple", "jmpeqi", "jmpgti", "jmpgei", "jmplti", "jmplei",
+    "print",
+};
+
+namespace regir {
+
+const int SLOTS = 8;
+const int MAX_REGISTERS = 65536;
+
+// A stack entry during translation: either a known constant or the register holding it.
+struct Value {
+    bool constant;
+    int value;
+};
+
+inline bool same(const Value& x, const Value& y) { return x.constant == y.constant && x.value == y.value; }
+
+int flip(int opcode) {
+    switch (opcode) {
+        case R_JGT: return R_JLT;
+        case R_JGE: return R_JLE;
+        case R_JLT: return R_JGT;
+        case R_JLE: return R_JGE;
+        default: return opcode;
+    }
+}
+
+// Within a block push, pop, dup, swap and load only rearrange the symbolic stack; code is
+// emitted for arithmetic and stores, and every slot whose value changed is written back before
+// the block is left or a print needs the stack.
+class Translator {
+private:
+    const Program& program;
+    const Verification& verification;
+    std::vector<RegOp>& out;
+    std::vector<Value> stack;
+    std::vector<size_t> jumps;
+    int temp_base, temps, max_temps;
+
+public:
+    Translator(const Program&, const Verification&, std::vector<RegOp>&);
+    bool translate(std::vector<int>&, int&);
+
+private:
+    int temp();
+    void emit(uint16_t, int, int, int, int32_t);
+    int references(int, const std::vector<Value*>&);
+    void copy_out(int, const std::vector<Value*>&);
+    void assign(int, Value, const std::vector<Value*>&);
+    void materialize(const std::vector<Value*>&);
+    void reset(int);
+    bool translate_op(uint32_t, int32_t);
+};
+
+Translator::Translator(const Program& program, const Verification& verification, std::vector<RegOp>& out)
+    : program(program), verification(verification), out(out),
+      temp_base(SLOTS + verification.max_depth), temps(0), max_temps(0) {}
+
+int Translator::temp() {
+    temps++;
+    if (temps > max_temps) max_temps = temps;
+    return temp_base + temps - 1;
+}
+
+void Translator::emit(uint16_t opcode, int dst, int a, int b, int32_t imm) {
+    out.push_back(RegOp{ opcode, static_cast<uint16_t>(dst), static_cast<uint16_t>(a), static_cast<uint16_t>(b), imm, 0 });
+}
+
+int Translator::references(int reg, const std::vector<Value*>& pinned) {
+    int count = 0;
+    for (const Value& entry : stack) count += !entry.constant && entry.value == reg;
+    for (const Value* entry : pinned) count += !entry->constant && entry->value == reg;
+    return count;
+}
+
+// Called before `reg` is overwritten: every live entry still naming it gets a private copy.
+void Translator::copy_out(int reg, const std::vector<Value*>& pinned) {
+    if (this->references(reg, pinned) == 0) return;
+    int copy = this->temp();
+    this->emit(R_MOV, copy, reg, 0, 0);
+    for (Value& entry : stack) {
+        if (!entry.constant && entry.value == reg) entry.value = copy;
+    }
+    for (Value* entry : pinned) {
+        if (!entry->constant && entry->value == reg) entry->value = copy;
+    }
+}
+
+// Moves `value` into `dst`. A temporary that was produced by the previous instruction and has no
+// other use is renamed instead, so `load 5; push 1; sub; store 5` is a single subi.
+void Translator::assign(int dst, Value value, const std::vector<Value*>& pinned) {
+    if (value.constant) {
+        this->emit(R_MOVI, dst, 0, 0, value.value);
+        return;
+    }
+    if (value.value == dst) return;
+    if (value.value >= temp_base && !out.empty() && out.back().opcode < R_JMP && out.back().opcode != R_HALT &&
+        out.back().dst == value.value && this->references(value.value, pinned) == 0) {
+        out.back().dst = dst;
+        return;
+    }
+    this->emit(R_MOV, dst, value.value, 0, 0);
+}
+
+void Translator::materialize(const std::vector<Value*>& pinned) {
+    std::vector<bool> written(stack.size(), false);
+    for (int p = 0; p < stack.size(); p++) written[p] = !same(stack[p], Value{ false, SLOTS + p });
+
+    for (int p = 0; p < stack.size(); p++) {
+        if (written[p]) this->copy_out(SLOTS + p, pinned);
+    }
+    for (int p = 0; p < stack.size(); p++) {
+        if (!written[p]) continue;
+        Value value = stack[p];
+        stack[p] = Value{ false, SLOTS + p };
+        this->assign(SLOTS + p, value, pinned);
+    }
+}
+
+void Translator::reset(int depth) {
+    stack.clear();
+    for (int p = 0; p < depth; p++) stack.push_back(Value{ false, SLOTS + p });
+    temps = 0;
+}
+
+// Translates one base instruction against the symbolic stack of the current block.
+bool Translator::translate_op(uint32_t opcode, int32_t operand) {
+    Value a, b;
+    std::vector<Value*> none;
+    switch (opcode) {
+        case Instruction::IPUSH: stack.push_back(Value{ true, operand }); break;
+        case Instruction::IPOP: stack.pop_back(); break;
+        case Instruction::IDUP: stack.push_back(stack.back()); break;
+        case Instruction::ISWAP: std::swap(stack[stack.size() - 1], stack[stack.size() - 2]); break;
+        case Instruction::ISKIP: break;
+        case Instruction::ILOAD: stack.push_back(Value{ false, operand }); break;
+        case Instruction::ISTORE:
+            a = stack.back();
+            stack.pop_back();
+            if (same(a, Value{ false, operand })) break;
+            this->copy_out(operand, { &a });
+            this->assign(operand, a, none);
+            break;
+        case Instruction::IADD: case Instruction::ISUB: case Instruction::IMUL: case Instruction::IDIV: {
+            b = stack.back();
+            stack.pop_back();
+            a = stack.back();
+            stack.pop_back();
+            int kind = opcode - Instruction::IADD;
+            bool commutes = opcode == Instruction::IADD || opcode == Instruction::IMUL;
+            if (a.constant && !b.constant && commutes) std::swap(a, b);
+            if (a.constant) {
+                int t = this->temp();
+                this->emit(R_MOVI, t, 0, 0, a.value);
+                a = Value{ false, t };
+            }
+            int dst = this->temp();
+            if (b.constant) this->emit(R_ADDI + kind, dst, a.value, 0, b.value);
+            else this->emit(R_ADD + kind, dst, a.value, b.value, 0);
+            stack.push_back(Value{ false, dst });
+            break;
+        }
+        case Instruction::IPRINT:
+            this->materialize(none);
+            this->emit(R_PRINT, 0, 0, 0, stack.size());
+            break;
+        case Instruction::IGOTO:
+            this->materialize(none);
+            this->emit(R_JMP, 0, 0, 0, 0);
+            out.back().target = operand;
+            jumps.push_back(out.size() - 1);
+            break;
+        case Instruction::IJMPEQ: case Instruction::IJMPGT: case Instruction::IJMPGE:
+        case Instruction::IJMPLT: case Instruction::IJMPLE: {
+            b = stack.back();
+            stack.pop_back();
+            a = stack.back();
+            stack.pop_back();
+            int jump = R_JEQ + (opcode - Instruction::IJMPEQ);
+            if (a.constant && !b.constant) {
+                std::swap(a, b);
+                jump = flip(jump);
+            }
+            if (a.constant) {
+                int t = this->temp();
+                this->emit(R_MOVI, t, 0, 0, a.value);
+                a = Value{ false, t };
+            }
+            this->materialize({ &a, &b });
+            if (b.constant) this->emit(jump + (R_JEQI - R_JEQ), 0, a.value, 0, b.value);
+            else this->emit(jump, 0, a.value, b.value, 0);
+            out.back().target = operand;
+            jumps.push_back(out.size() - 1);
+            break;
+        }
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool Translator::translate(std::vector<int>& entry_of, int& num_registers) {
+    const Op* code = program.data();
+    int n = program.size();
+
+    std::vector<bool> leader(n + 1, false);
+    leader[0] = leader[n] = true;
+    for (int pc = 0; pc < n; pc += op_info[code[pc].opcode].words) {
+        if (!Program::is_jump(code[pc].opcode)) continue;
+        leader[code[pc].operand] = true;
+        leader[pc + op_info[code[pc].opcode].words] = true;
+    }
+    for (const std::pair<int, std::string_view>& label : program.debug.labels) leader[label.first] = true;
+
+    entry_of.assign(n + 1, -1);
+    std::vector<Value*> none;
+    bool open = false;
+
+    for (int pc = 0; pc <= n; pc += pc < n ? op_info[code[pc].opcode].words : 1) {
+        if (verification.depth[pc] < 0) continue;
+        if (leader[pc]) {
+            if (open) this->materialize(none);
+            this->reset(verification.depth[pc]);
+            entry_of[pc] = out.size();
+        }
+        open = true;
+        if (pc == n) {
+            this->emit(R_HALT, 0, 0, 0, 0);
+            break;
+        }
+
+        const Op& op = code[pc];
+        if (op.opcode >= OP_LOAD_JMPEQ && op.opcode <= OP_LOAD_JMPLE) {
+            this->translate_op(Instruction::ILOAD, code[pc + 1].opcode);
+            this->translate_op(Instruction::IPUSH, code[pc + 1].operand);
+            this->translate_op(Instruction::IJMPEQ + (op.opcode - OP_LOAD_JMPEQ), op.operand);
+            continue;
+        }
+        switch (op.opcode) {
+            case OP_ADDI: case OP_SUBI: case OP_MULI:
+                this->translate_op(Instruction::IPUSH, op.operand);
+                this->translate_op(Instruction::IADD + (op.opcode - OP_ADDI), 0);
+                break;
+            case OP_DUPSUBI:
+                this->translate_op(Instruction::IDUP, 0);
+                this->translate_op(Instruction::IPUSH, op.operand);
+                this->translate_op(Instruction::ISUB, 0);
+                break;
+            case OP_LOADADD:
+                this->translate_op(Instruction::ILOAD, op.operand);
+                this->translate_op(Instruction::IADD, 0);
+                break;
+            case OP_TEE:
+                this->translate_op(Instruction::ISTORE, op.operand);
+                this->translate_op(Instruction::ILOAD, op.operand);
+                break;
+            default:
+                if (!this->translate_op(op.opcode, op.operand)) return false;
+        }
+        if (op.opcode == Instruction::IGOTO) open = false;
+    }
+
+    for (size_t at : jumps) out[at].target = entry_of[out[at].target];
+    num_registers = temp_base + max_temps;
+    return num_registers <= MAX_REGISTERS;
+}
+
+} // namespace regir
+
+RegisterVM::RegisterVM(const Program& program, const Verification& verification)
+    : num_registers(0), final_depth(0), temp_base(regir::SLOTS + verification.max_depth), translated(false) {
+    if (!verification.ok) return;
+    std::vector<int> entry_of;
+    regir::Translator translator(program, verification, code);
+    if (!translator.translate(entry_of, num_registers)) return;
+
+    final_depth = verification.depth[program.size()];
+    for (const std::pair<int, std::string_view>& label : program.debug.labels) {
+        if (entry_of[label.first] >= 0) labels.emplace_back(entry_of[label.first], label.second);
+    }
+    translated = true;
+}
+
+bool RegisterVM::ok() const { return translated; }
+size_t RegisterVM::size() const { return code.size(); }
+
+// Runs from the first instruction with the SVM registers copied in, then copies them back and
+// leaves the final operand stack in `stack`/`depth`. `file` is the caller's scratch register
+// file, so one RegisterVM can serve several threads. Returns the number of dispatches. A division
+// by zero, or of INT_MIN by -1, stops the run with `error` set and an empty operand stack.
+template<bool Counted>
+long long RegisterVM::run(int* registers, std::vector<int>& file, std::vector<int>& stack, int& depth,
+                          OutputSink& out, const char*& error) const {
+    if (file.size() < num_registers) file.resize(num_registers);
+    int* r = file.data();
+    const RegOp* base = code.data();
+    const RegOp* ip = base;
+    long long dispatched = 0;
+    std::copy(registers, registers + regir::SLOTS, r);
+    error = nullptr;
+
+#define RVM_JUMP(cond) ip = (cond) ? base + ip->target : ip + 1
+#define RVM_DIVIDE(divisor) \
+    if ((divisor) == 0) { error = "Division by zero"; goto failed; } \
+    if ((divisor) == -1 && r[ip->a] == INT_MIN) { error = "Integer overflow in division"; goto failed; } \
+    r[ip->dst] = r[ip->a] / (divisor);
+#ifdef SVM_COMPUTED_GOTO
+    static const void* const dispatch[NUM_REG_OPCODES] = {
+        &&L_R_HALT, &&L_R_MOV, &&L_R_MOVI, &&L_R_ADD, &&L_R_SUB, &&L_R_MUL, &&L_R_DIV,
+        &&L_R_ADDI, &&L_R_SUBI, &&L_R_MULI, &&L_R_DIVI, &&L_R_JMP,
+        &&L_R_JEQ, &&L_R_JGT, &&L_R_JGE, &&L_R_JLT, &&L_R_JLE,
+        &&L_R_JEQI, &&L_R_JGTI, &&L_R_JGEI, &&L_R_JLTI, &&L_R_JLEI, &&L_R_PRINT };
+#define RVM_CASE(op) L_##op: if (Counted) dispatched++;
+#define RVM_NEXT() goto *dispatch[ip->opcode]
+    RVM_NEXT();
+#else
+#define RVM_CASE(op) case op: if (Counted) dispatched++;
+#define RVM_NEXT() continue
+    for (;;) switch (ip->opcode) {
+#endif
+    RVM_CASE(R_MOV) r[ip->dst] = r[ip->a]; ip++; RVM_NEXT();
+    RVM_CASE(R_MOVI) r[ip->dst] = ip->imm; ip++; RVM_NEXT();
+    RVM_CASE(R_ADD) r[ip->dst] = r[ip->a] + r[ip->b]; ip++; RVM_NEXT();
+    RVM_CASE(R_SUB) r[ip->dst] = r[ip->a] - r[ip->b]; ip++; RVM_NEXT();
+    RVM_CASE(R_MUL) r[ip->dst] = r[ip->a] * r[ip->b]; ip++; RVM_NEXT();
+    RVM_CASE(R_DIV) RVM_DIVIDE(r[ip->b]) ip++; RVM_NEXT();
+    RVM_CASE(R_ADDI) r[ip->dst] = r[ip->a] + ip->imm; ip++; RVM_NEXT();
+    RVM_CASE(R_SUBI) r[ip->dst] = r[ip->a] - ip->imm; ip++; RVM_NEXT();
+    RVM_CASE(R_MULI) r[ip->dst] = r[ip->a] * ip->imm; ip++; RVM_NEXT();
+    RVM_CASE(R_DIVI) RVM_DIVIDE(ip->imm) ip++; RVM_NEXT();
+    RVM_CASE(R_JMP) ip = base + ip->target; RVM_NEXT();
+    RVM_CASE(R_JEQ) RVM_JUMP(r[ip->a] == r[ip->b]); RVM_NEXT();
+    RVM_CASE(R_JGT) RVM_JUMP(r[ip->a] > r[ip->b]); RVM_NEXT();
+    RVM_CASE(R_JGE) RVM_JUMP(r[ip->a] >= r[ip->b]); RVM_NEXT();
+    RVM_CASE(R_JLT) RVM_JUMP(r[ip->a] < r[ip->b]); RVM_NEXT();
+    RVM_CASE(R_JLE) RVM_JUMP(r[ip->a] <= r[ip->b]); RVM_NEXT();
+    RVM_CASE(R_JEQI) RVM_JUMP(r[ip->a] == ip->imm); RVM_NEXT();
+    RVM_CASE(R_JGTI) RVM_JUMP(r[ip->a] > ip->imm); RVM_NEXT();
+    RVM_CASE(R_JGEI) RVM_JUMP(r[ip->a] >= ip->imm); RVM_NEXT();
+    RVM_CASE(R_JLTI) RVM_JUMP(r[ip->a] < ip->imm); RVM_NEXT();
+    RVM_CASE(R_JLEI) RVM_JUMP(r[ip->a] <= ip->imm); RVM_NEXT();
+    RVM_CASE(R_PRINT) out.write_stack(r + regir::SLOTS, ip->imm); ip++; RVM_NEXT();
+    RVM_CASE(R_HALT) goto halted;
+#ifndef SVM_COMPUTED_GOTO
+    default: goto halted;
+    }
+#endif
+halted:
+#undef RVM_JUMP
+#undef RVM_DIVIDE
+#undef RVM_CASE
+#undef RVM_NEXT
+
+    std::copy(r, r + regir::SLOTS, registers);
+    if (stack.size() < final_depth) stack.resize(final_depth);
+    std::copy(r + regir::SLOTS, r + regir::SLOTS + final_depth, stack.begin());
+    depth = final_depth;
+    return dispatched;
+
+failed:
+    std::copy(r, r + regir::SLOTS, registers);
+    depth = 0;
+    return dispatched;
+}
+
+template long long RegisterVM::run<true>(int*, std::vector<int>&, std::vector<int>&, int&, OutputSink&,
+                                         const char*&) const;
+template long long RegisterVM::run<false>(int*, std::vector<int>&, std::vector<int>&, int&, OutputSink&,
+                                          const char*&) const;
+
+void RegisterVM::print_register(int reg, int temp_base) {
+    if (reg < regir::SLOTS) std::cout << "r" << reg;
+    else if (reg < temp_base) std::cout << "s" << reg - regir::SLOTS;
+    else std::cout << "t" << reg - temp_base;
+}
+
+void RegisterVM::print() const {
+    size_t next_label = 0;
+    for (int i = 0; i < code.size(); i++) {
+        const RegOp& op = code[i];
+        while (next_label < labels.size() && labels[next_label].first < i) next_label++;
+        if (next_label < labels.size() && labels[next_label].first == i) std::cout << labels[next_label].second << ": ";
+        std::cout << reg_names[op.opcode] << " ";
+        if (op.opcode == R_PRINT) std::cout << op.imm;
+        else if (op.opcode == R_JMP) std::cout << "@" << op.target;
+        else if (op.opcode >= R_JEQ && op.opcode <= R_JLEI) {
+            print_register(op.a, temp_base);
+            std::cout << ", ";
+            if (op.opcode >= R_JEQI) std::cout << op.imm;
+            else print_register(op.b, temp_base);
+            std::cout << " @" << op.target;
+        } else if (op.opcode != R_HALT) {
+            print_register(op.dst, temp_base);
+            std::cout << " = ";
+            if (op.opcode == R_MOVI) std::cout << op.imm;
+            else print_register(op.a, temp_base);
+            if (op.opcode >= R_ADD && op.opcode <= R_DIV) {
+                std::cout << ", ";
+                print_register(op.b, temp_base);
+            }
+            if (op.opcode >= R_ADDI && op.opcode <= R_DIVI) std::cout << ", " << op.imm;
+        }
+        std::cout << std::endl;
+    }
+}
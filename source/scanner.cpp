@@ -0,0 +1,160 @@
+#include "../include/lexer.h"
+#include "../include/scanner.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace lexer {
+
+// Returns the offset of the first byte in [p, end) that is neither ' ' nor '\t'.
+inline size_t skip_spaces(const char* p, const char* end) {
+    const char* start = p;
+#if defined(__AVX2__)
+    const __m256i space32 = _mm256_set1_epi8(' '), tab32 = _mm256_set1_epi8('\t');
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space32), _mm256_cmpeq_epi8(chunk, tab32));
+        uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(blank));
+        if (mask) return (p - start) + __builtin_ctz(mask);
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab));
+        uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(blank)) & 0xFFFF;
+        if (mask) return (p - start) + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p - start;
+}
+
+// Returns the offset of the first '\n' in [p, end), or end - p if there is none.
+inline size_t find_newline(const char* p, const char* end) {
+    const char* start = p;
+#if defined(__AVX2__)
+    const __m256i newline32 = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline32)));
+        if (mask) return (p - start) + __builtin_ctz(mask);
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        if (mask) return (p - start) + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\n') p++;
+    return p - start;
+}
+
+} // namespace lexer
+
+Scanner::Scanner(std::string_view input): input(input), current(0), stream(nullptr), chunk_size(0), pending_eol(false) {}
+
+Scanner::Scanner(std::istream& stream, size_t chunk_size)
+    : current(0), stream(&stream), chunk_size(chunk_size), pending_eol(false) {
+    buffer.reserve(chunk_size);
+}
+
+// Streaming mode only ever exposes whole lines, so no token straddles two chunks. The
+// unfinished tail of the last line read is carried over to the front of the next chunk.
+bool Scanner::refill() {
+    if (!stream) return false;
+
+    buffer.erase(0, input.size());
+    size_t last_newline = buffer.rfind('\n');
+    while (last_newline == std::string::npos && *stream) {
+        size_t old_size = buffer.size();
+        buffer.resize(old_size + chunk_size);
+        stream->read(&buffer[old_size], chunk_size);
+        buffer.resize(old_size + stream->gcount());
+        last_newline = buffer.rfind('\n');
+    }
+    if (!*stream) stream = nullptr;
+
+    size_t length = (stream && last_newline != std::string::npos) ? last_newline + 1 : buffer.size();
+    input = std::string_view(buffer.data(), length);
+    current = 0;
+
+    if (pending_eol) {
+        while (current < input.size() && input[current] == '\n') current++;
+        pending_eol = current == input.size();
+    }
+    return true;
+}
+
+// Offset just past the last token read, within the chunk being scanned in streaming mode.
+size_t Scanner::position() const { return current; }
+
+Token::Type Scanner::check_reserved(std::string_view lexeme) { return lexer::keyword(lexeme); }
+
+void Scanner::skip_blanks() {
+    const char* end = input.data() + input.size();
+
+    if (current < input.size() && input[current] == ' ') current++;
+    while (true) {
+        if (current >= input.size()) return;
+        char c = input[current];
+        if (c != ' ' && c != '\t' && c != '%') return;
+        current += lexer::skip_spaces(input.data() + current, end);
+        if (current >= input.size() || input[current] != '%') return;
+        current += lexer::find_newline(input.data() + current, end);
+        if (current < input.size()) current++;
+    }
+}
+
+Token Scanner::next_token() {
+    this->skip_blanks();
+    while (current >= input.size()) {
+        if (!this->refill()) return Token(Token::END);
+        this->skip_blanks();
+    }
+
+    const unsigned char* text = reinterpret_cast<const unsigned char*>(input.data());
+    size_t length = input.size();
+    size_t first = current;
+    uint8_t state = lexer::S_START;
+
+    while (state < lexer::S_ACCEPT_ID) {
+        state = current < length ? lexer::transitions[state][text[current]] : lexer::transitions[state]['\0'];
+        current++;
+    }
+
+    switch (state) {
+        case lexer::S_ACCEPT_ID: {
+            current--;
+            std::string_view lexeme = input.substr(first, current - first);
+            Token::Type token_type = check_reserved(lexeme);
+
+            if (token_type != Token::ERR) return Token(token_type);
+            else return Token(Token::ID, lexeme);
+        }
+        case lexer::S_ACCEPT_LABEL:
+            return Token(Token::LABEL, input.substr(first, current - 1 - first));
+        case lexer::S_ACCEPT_NUM:
+            current--;
+            return Token(Token::NUM, input.substr(first, current - first));
+        case lexer::S_ACCEPT_EOL:
+            current--;
+            if (current == length) pending_eol = true;
+            return Token(Token::EOL);
+        case lexer::S_ACCEPT_END:
+            current = length;
+            stream = nullptr;
+            return Token(Token::END);
+        default:
+            return Token(Token::ERR, input.substr(first, 1));
+    }
+}
+
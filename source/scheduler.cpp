@@ -0,0 +1,94 @@
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "../include/scheduler.h"
+
+Scheduler::Task::Task(std::shared_ptr<Executable> executable, const BatchInput& input, const TaskLimits& limits)
+    : out(), svm(std::move(executable)), limits(limits), result(), finished(false) {
+    svm.set_output(out);
+    svm.reset(input.registers, input.stack);
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double>(limits.timeout_seconds));
+}
+
+Scheduler::Scheduler(int threads, long long quantum)
+    : quantum(quantum < 1 ? 1 : quantum), threads(threads < 1 ? 1 : threads) {}
+
+size_t Scheduler::submit(std::shared_ptr<Executable> executable, const BatchInput& input, const TaskLimits& limits) {
+    tasks.emplace_back(new Task(std::move(executable), input, limits));
+    return tasks.size() - 1;
+}
+
+void Scheduler::finish(Task& task, const Status& status) {
+    task.svm.flush_output();
+    if (status.ok()) task.svm.print_stack();
+    else task.out << "error: " << status.message << std::endl;
+    task.result.status = status;
+    task.result.output = task.out.str();
+    task.out.str(std::string());
+    task.finished = true;
+}
+
+// Runs one slice of `task`; true once it has finished.
+bool Scheduler::run_slice(Task& task) {
+    const TaskLimits& limits = task.limits;
+    if (limits.timeout_seconds > 0 && std::chrono::steady_clock::now() > task.deadline) {
+        this->finish(task, Status(Status::RUNTIME_ERROR, "Deadline exceeded"));
+        return true;
+    }
+    long long slice = quantum;
+    if (limits.max_instructions > 0) slice = std::min(slice, limits.max_instructions - task.result.instructions);
+    long long budget = slice;
+    SVM::Stop stop;
+    do {
+        stop = task.svm.resume(budget);
+    } while (stop == SVM::PRINTED && budget > 0);
+    task.result.instructions += slice - budget;
+    task.result.slices++;
+
+    if (stop == SVM::HALTED) this->finish(task, Status());
+    else if (stop == SVM::FAILED) this->finish(task, task.svm.status());
+    else if (limits.max_instructions > 0 && task.result.instructions >= limits.max_instructions)
+        this->finish(task, Status(Status::RUNTIME_ERROR, "Instruction limit exceeded"));
+    return task.finished;
+}
+
+// Runs every unfinished instance to completion. The queue lock is taken once per slice, which
+// the quantum keeps rare.
+void Scheduler::run() {
+    std::deque<Task*> queue;
+    for (std::unique_ptr<Task>& task : tasks) if (!task->finished) queue.push_back(task.get());
+    size_t remaining = queue.size();
+    std::mutex lock;
+    std::condition_variable ready;
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            ready.wait(guard, [&]() { return !queue.empty() || remaining == 0; });
+            if (remaining == 0) return;
+            Task* task = queue.front();
+            queue.pop_front();
+            guard.unlock();
+            bool finished = this->run_slice(*task);
+            guard.lock();
+            if (!finished) {
+                queue.push_back(task);
+                ready.notify_one();
+            } else if (--remaining == 0) {
+                ready.notify_all();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) workers.emplace_back(worker);
+    worker();
+    for (std::thread& thread : workers) thread.join();
+}
+
+const TaskResult& Scheduler::result(size_t index) const { return tasks[index]->result; }
+
+size_t Scheduler::size() const { return tasks.size(); }
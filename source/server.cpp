@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include "../include/batch.h"
+#include "../include/server.h"
+
+namespace wire {
+
+// Blocking calls wait in polls of this length, so a stopping server notices within POLL_MS even
+// on an idle connection.
+const int POLL_MS = 200;
+const size_t MAX_LINE = 4096;
+const size_t MAX_SOURCE = 64 << 20;
+
+// Buffered reads and whole writes on one connected socket.
+class Connection {
+private:
+    int fd;
+    const std::atomic<bool>& stopping;
+    char buffer[64 * 1024];
+    size_t start, end;
+
+    bool fill();
+
+public:
+    Connection(int fd, const std::atomic<bool>& stopping);
+    bool read_line(std::string&);
+    bool read_bytes(size_t, std::string&);
+    bool write_all(const std::string&);
+};
+
+Connection::Connection(int fd, const std::atomic<bool>& stopping): fd(fd), stopping(stopping), start(0), end(0) {}
+
+bool Connection::fill() {
+    while (!stopping) {
+        pollfd ready = { fd, POLLIN, 0 };
+        int count = poll(&ready, 1, POLL_MS);
+        if (count < 0 && errno != EINTR) return false;
+        if (count <= 0) continue;
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        start = 0;
+        end = n;
+        return true;
+    }
+    return false;
+}
+
+// Reads up to the next '\n', which is dropped. False at end of input or on an over-long line.
+bool Connection::read_line(std::string& line) {
+    line.clear();
+    while (true) {
+        if (start == end && !this->fill()) return false;
+        const char* from = buffer + start;
+        const char* newline = static_cast<const char*>(std::memchr(from, '\n', end - start));
+        size_t taken = newline ? newline - from : end - start;
+        line.append(from, taken);
+        start += taken;
+        if (line.size() > MAX_LINE) return false;
+        if (newline) {
+            start++;
+            return true;
+        }
+    }
+}
+
+bool Connection::read_bytes(size_t length, std::string& out) {
+    out.clear();
+    while (out.size() < length) {
+        if (start == end && !this->fill()) return false;
+        size_t taken = std::min(end - start, length - out.size());
+        out.append(buffer + start, taken);
+        start += taken;
+    }
+    return true;
+}
+
+bool Connection::write_all(const std::string& data) {
+    for (size_t done = 0; done < data.size();) {
+        ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+} // namespace wire
+
+Server::Server(ProgramCache& cache, int threads, const TaskLimits& limits)
+    : cache(cache), threads(threads < 1 ? 1 : threads), limits(limits), listener(-1), stopping(false), requests(0) {}
+
+Server::~Server() {
+    if (listener >= 0) {
+        close(listener);
+        unlink(path.c_str());
+    }
+}
+
+// Binds the socket, replacing a stale one left at `path` by an earlier run.
+Status Server::listen(const std::string& path) {
+    sockaddr_un address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return Status(Status::INVALID_INPUT, "Socket path too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return Status(Status::IO_ERROR, std::string("Unable to create socket: ") + std::strerror(errno));
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 128) != 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        Status status(Status::IO_ERROR, "Unable to listen on " + path + ": " + std::strerror(errno));
+        close(fd);
+        return status;
+    }
+    listener = fd;
+    this->path = path;
+    return Status();
+}
+
+// Runs the workers until stop(); the calling thread is one of them.
+void Server::serve() {
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) workers.emplace_back([this]() { this->worker(); });
+    this->worker();
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Only sets a flag, so it is safe to call from a signal handler.
+void Server::stop() { stopping = true; }
+
+// The listener is non-blocking: every worker polls it, and the ones that lose the race for a
+// connection go back to waiting.
+void Server::worker() {
+    SVM svm(std::make_shared<Executable>(Program()));
+    while (!stopping) {
+        pollfd ready = { listener, POLLIN, 0 };
+        if (poll(&ready, 1, wire::POLL_MS) <= 0) continue;
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        this->serve_connection(fd, svm);
+        close(fd);
+    }
+}
+
+void Server::serve_connection(int fd, SVM& svm) {
+    wire::Connection connection(fd, stopping);
+    std::string line, source, payload;
+    std::ostringstream out;
+    std::shared_ptr<Executable> executable;
+    BatchInput input;
+
+    while (connection.read_line(line)) {
+        std::istringstream header(line);
+        std::string command;
+        header >> command;
+        Status status;
+        bool framed = true;
+        if (command == "STATS") {
+            payload = this->stats_line();
+        } else if (command == "RUN") {
+            int level;
+            size_t length;
+            framed = header >> level >> length && length <= wire::MAX_SOURCE;
+            if (framed && !(connection.read_bytes(length, source) && connection.read_line(line))) return;
+            requests++;
+            if (!framed) status = Status(Status::INVALID_INPUT, "Malformed request: " + line);
+            else if (level < 0 || level > 2) status = Status(Status::INVALID_INPUT, "Invalid optimization level: " + std::to_string(level));
+            else if (!parse_batch_input(line, input)) status = Status(Status::INVALID_INPUT, "Invalid input: " + line);
+            else status = cache.get(source, level, executable);
+
+            if (status.ok()) {
+                out.str(std::string());
+                svm.load(executable);
+                svm.set_output(out);
+                svm.reset(input.registers, input.stack);
+                status = this->run_request(svm);
+                if (status.ok()) svm.print_stack();
+                else out << "error: " << status.message << std::endl;
+                payload = out.str();
+            } else {
+                payload = status.message + "\n";
+            }
+        } else {
+            status = Status(Status::INVALID_INPUT, "Unknown command: " + command);
+            payload = status.message + "\n";
+            framed = false;
+        }
+
+        std::string response = std::string(Status::code_name(status.code)) + " " + std::to_string(payload.size()) + "\n";
+        response += payload;
+        // After a malformed request the rest of the stream cannot be framed: answer and hang up.
+        if (!connection.write_all(response) || !framed) return;
+    }
+}
+
+// Runs the loaded request to the end, one slice at a time, as Scheduler::run_slice() does.
+Status Server::run_request(SVM& svm) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(limits.timeout_seconds));
+    long long executed = 0;
+    while (true) {
+        long long slice = SLICE;
+        if (limits.max_instructions > 0) slice = std::min(slice, limits.max_instructions - executed);
+        long long budget = slice;
+        SVM::Stop stop;
+        do {
+            stop = svm.resume(budget);
+        } while (stop == SVM::PRINTED && budget > 0);
+        executed += slice - budget;
+
+        if (stop == SVM::HALTED) return Status();
+        if (stop == SVM::FAILED) return svm.status();
+        svm.flush_output();
+        if (limits.max_instructions > 0 && executed >= limits.max_instructions)
+            return Status(Status::RUNTIME_ERROR, "Instruction limit exceeded");
+        if (limits.timeout_seconds > 0 && std::chrono::steady_clock::now() > deadline)
+            return Status(Status::RUNTIME_ERROR, "Deadline exceeded");
+        if (stopping) return Status(Status::RUNTIME_ERROR, "Server stopping");
+    }
+}
+
+std::string Server::stats_line() {
+    CacheStats stats = cache.stats();
+    return "requests=" + std::to_string(requests) + " hits=" + std::to_string(stats.hits) +
+           " misses=" + std::to_string(stats.misses) + " evictions=" + std::to_string(stats.evictions) +
+           " entries=" + std::to_string(stats.entries) + " bytes=" + std::to_string(stats.bytes) + "\n";
+}
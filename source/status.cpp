@@ -0,0 +1,12 @@
+#include "../include/status.h"
+
+Status::Status(): code(OK) {}
+Status::Status(Code code, std::string message): code(code), message(std::move(message)) {}
+
+bool Status::ok() const { return code == OK; }
+
+const char* Status::code_name(Code code) {
+    static const char* names[] = { "ok", "syntax_error", "unknown_label", "invalid_image", "invalid_input",
+                                   "io_error", "runtime_error" };
+    return names[code];
+}
@@ -0,0 +1,511 @@
+#include <climits>
+#include "../include/svm.h"
+
+Executable::Executable(Program&& program): program(std::move(program)) {
+    verification = verify(this->program);
+}
+
+// For callers that replace `program` in place: re-verifies it, reusing the depth table, and
+// drops the translations of the previous program.
+void Executable::reload() {
+    verify(program, verification);
+    jit.reset();
+    register_vm.reset();
+}
+
+bool Executable::enable_jit() {
+    if (!jit) jit = jit_compile(program, verification);
+    return jit != nullptr;
+}
+
+bool Executable::enable_register_vm() {
+    if (register_vm) return true;
+    register_vm.reset(new RegisterVM(program, verification));
+    if (!register_vm->ok()) register_vm.reset();
+    return register_vm != nullptr;
+}
+
+// Stops the run: the error is kept until the next reset() and returned by execute().
+void SVM::fail(const std::string& msg) { failure = Status(Status::RUNTIME_ERROR, msg); }
+
+void SVM::grow_stack() { context.stack.resize(context.stack.size() < 16 ? 16 : context.stack.size() * 2); }
+
+SVM::SVM(Program&& program): SVM(std::make_shared<Executable>(std::move(program))) {}
+
+SVM::SVM(std::shared_ptr<Executable> executable)
+    : executable(std::move(executable)), counting(false), tracer(nullptr), output(std::cout), stopped(HALTED) {
+    context.out = &output;
+    this->reset(nullptr, std::vector<int>());
+}
+
+// Switches to another program, keeping the operand stack and register file storage.
+void SVM::load(std::shared_ptr<Executable> executable) {
+    this->executable = std::move(executable);
+    if (profile) profile.reset(new Profile(this->executable->program.size() + 1));
+    this->reset(nullptr, std::vector<int>());
+}
+
+// Rewinds to the first instruction with the given registers (all zero when null) and initial
+// stack, bottom first.
+void SVM::reset(const int* registers, const std::vector<int>& stack) {
+    const Verification& verification = executable->verification;
+    for (int i = 0; i < 8; i++) context.registers[i] = registers ? registers[i] : 0;
+    context.stack = stack;
+    context.depth = context.entry_depth = stack.size();
+    context.pc = 0;
+    context.dispatched = context.source_executed = 0;
+    failure = Status();
+    context.stack.resize(context.depth + (verification.ok ? verification.max_depth + 1 : 16));
+}
+
+// Prints go through the SVM's own sink into `out`.
+void SVM::set_output(std::ostream& out) {
+    output.set_stream(out);
+    context.out = &output;
+}
+
+void SVM::set_output(OutputSink& sink) {
+    if (context.out != &sink) context.out->flush();
+    context.out = &sink;
+}
+
+void SVM::flush_output() { context.out->flush(); }
+
+// The end of a run: hands buffered prints to the stream.
+Status SVM::finish() {
+    context.out->flush();
+    return failure;
+}
+
+bool SVM::enable_jit() { return executable->enable_jit(); }
+bool SVM::enable_register_vm() { return executable->enable_register_vm(); }
+
+bool SVM::verified() { return executable->verification.ok; }
+int SVM::max_depth() { return executable->verification.max_depth; }
+
+void SVM::count_instructions(bool enabled) { counting = enabled; }
+
+void SVM::profile_execution(bool enabled) {
+    if (!enabled) profile.reset();
+    else if (!profile) profile.reset(new Profile(executable->program.size() + 1));
+}
+
+const Profile* SVM::execution_profile() { return profile.get(); }
+
+// Records what execute() runs into `trace`, or stops recording when null.
+// Tracing takes precedence over the JIT and the profiler. False when the tracer was compiled out
+// with SVM_NO_TRACE.
+bool SVM::trace_to(Trace* trace) {
+#ifdef SVM_NO_TRACE
+    tracer = nullptr;
+    return trace == nullptr;
+#else
+    tracer = trace;
+    return true;
+#endif
+}
+const Program& SVM::program() { return executable->program; }
+long long SVM::instructions_dispatched() { return context.dispatched; }
+long long SVM::source_instructions_executed() { return context.source_executed; }
+const Status& SVM::status() { return failure; }
+
+// Executes one instruction. False at the end of the program or once the run has failed.
+bool SVM::step() {
+    if (!failure.ok() || context.pc >= executable->program.size()) return false;
+    this->run<CHECKED | SINGLE_STEP>();
+    return failure.ok();
+}
+
+// Native code runs until it reaches an instruction it leaves to the interpreter, which executes
+// that one instruction and hands control back. The generated code addresses slots relative to
+// the caller-supplied initial stack.
+Status SVM::execute() {
+    const Executable& exe = *executable;
+    ExecutionContext& c = context;
+    bool fast = exe.verification.ok && c.pc == 0 && c.depth == c.entry_depth;
+#ifndef SVM_NO_TRACE
+    if (tracer) {
+        // Traced runs always count, so that the trace can say how many instructions the run took.
+        long long dispatched = c.dispatched, source_executed = c.source_executed;
+        tracer->begin(exe.program, c.pc, c.registers, c.stack.data(), c.depth);
+        if (fast) this->run<TRACED | COUNTED>();
+        else this->run<TRACED | CHECKED | COUNTED>();
+        // The instruction that failed was counted but did not complete.
+        tracer->end(c.pc, !failure.ok(), c.dispatched - dispatched - !failure.ok());
+        if (!counting) c.dispatched = dispatched, c.source_executed = source_executed;
+        return this->finish();
+    }
+#endif
+    if (fast && exe.jit && !counting && !profile) {
+        while (exe.jit->can_enter(c.pc)) {
+            c.pc = exe.jit->run(c.stack.data() + c.entry_depth, c.registers, c.pc);
+            c.depth = c.entry_depth + exe.verification.depth[c.pc];
+            if (c.pc >= exe.program.size()) return this->finish();
+            if (!this->step()) return this->finish();
+        }
+        this->run<0>();
+        return this->finish();
+    }
+    switch ((fast ? 0 : CHECKED) | (counting ? COUNTED : 0) | (profile ? PROFILED : 0)) {
+        case 0: this->run<0>(); break;
+        case COUNTED: this->run<COUNTED>(); break;
+        case PROFILED: this->run<PROFILED>(); break;
+        case COUNTED | PROFILED: this->run<COUNTED | PROFILED>(); break;
+        case CHECKED: this->run<CHECKED>(); break;
+        case CHECKED | COUNTED: this->run<CHECKED | COUNTED>(); break;
+        case CHECKED | PROFILED: this->run<CHECKED | PROFILED>(); break;
+        default: this->run<CHECKED | COUNTED | PROFILED>(); break;
+    }
+    return this->finish();
+}
+
+// Runs until the program ends or fails, a print has executed, or about `budget` instructions
+// have run, and subtracts the instructions run from `budget`. Every bit of state lives in the
+// context, so the next call picks up where this one stopped. The charge is exact, but the budget
+// is only checked when a jump is taken, which every loop back-edge is: straight-line code runs to
+// the next jump or the end, and never pays for the check. A two-word superinstruction counts as
+// two. Always interpreted, never JIT code.
+SVM::Stop SVM::resume(long long& budget) {
+    if (!failure.ok()) return FAILED;
+    if (context.pc >= executable->program.size()) return HALTED;
+    context.budget = budget;
+    bool fast = executable->verification.ok;
+    switch ((fast ? 0 : CHECKED) | (counting ? COUNTED : 0)) {
+        case 0: this->run<BUDGETED>(); break;
+        case COUNTED: this->run<BUDGETED | COUNTED>(); break;
+        case CHECKED: this->run<BUDGETED | CHECKED>(); break;
+        default: this->run<BUDGETED | CHECKED | COUNTED>(); break;
+    }
+    budget = context.budget;
+    if (!failure.ok() || stopped == HALTED) this->finish();
+    return failure.ok() ? stopped : FAILED;
+}
+
+// Runs the register-machine translation from the start. Falls back to execute() when it is not
+// enabled, the stack VM has already been stepped or the run starts from a non-empty stack.
+Status SVM::execute_registers() {
+    const RegisterVM* register_vm = executable->register_vm.get();
+    ExecutionContext& c = context;
+    if (!register_vm || c.pc != 0 || c.depth != 0) return this->execute();
+    const char* error;
+    if (counting) c.dispatched += register_vm->run<true>(c.registers, c.register_file, c.stack, c.depth, *c.out, error);
+    else register_vm->run<false>(c.registers, c.register_file, c.stack, c.depth, *c.out, error);
+    if (error) this->fail(error);
+    else c.pc = executable->program.size();
+    return this->finish();
+}
+
+// `sp` points one past the top of the stack and is written back to `depth` only when control
+// leaves the loop (stack growth, halt). The VM_NEED/VM_ROOM/VM_REGISTER checks vanish when the
+// CHECKED bit is off, the profile counters when PROFILED is and the recording of branches and
+// stores when TRACED is.
+template<int Mode>
+void SVM::run() {
+    const bool Checked = Mode & CHECKED;
+    const Op* code = executable->program.data();
+    const Op* ip = code + context.pc;
+    int* base = context.stack.data();
+    int* sp = base + context.depth;
+    int next, top, reg;
+    bool taken;
+    long long* hits = (Mode & PROFILED) ? profile->executed.data() : nullptr;
+    long long* taken_counts = (Mode & PROFILED) ? profile->taken.data() : nullptr;
+    int peak = (Mode & PROFILED) ? profile->peak_depth : 0;
+    Trace* trace = (Mode & TRACED) ? tracer : nullptr;
+    // Budget plus the index of the current instruction, so that only taken jumps need to touch
+    // it: the budget left at ip is credit - (ip - code).
+    long long credit = (Mode & BUDGETED) ? context.budget + context.pc : 0;
+
+#define VM_ROOM() \
+    if (Checked && sp == base + context.stack.size()) { \
+        context.depth = sp - base; \
+        this->grow_stack(); \
+        base = context.stack.data(); \
+        sp = base + context.depth; \
+    }
+#define VM_COUNT() \
+    if (Mode & COUNTED) { \
+        context.dispatched++; \
+        context.source_executed += op_info[ip->opcode].fuses; \
+    } \
+    if (Mode & PROFILED) { \
+        hits[ip - code]++; \
+        if (sp - base > peak) peak = sp - base; \
+    }
+#define VM_SAVE_PEAK() \
+    if (Mode & PROFILED) profile->peak_depth = std::max<int>(peak, sp - base);
+#define VM_STOP(reason) { \
+        VM_SAVE_PEAK() \
+        context.depth = sp - base; \
+        context.pc = ip - code; \
+        stopped = (reason); \
+        if (Mode & BUDGETED) context.budget = credit - (ip - code); \
+        return; \
+    }
+#define VM_JUMP(target, words) \
+    if (Mode & BUDGETED) { \
+        const Op* to = code + (target); \
+        credit += to - ip - (words); \
+        ip = to; \
+        if (credit <= ip - code) VM_STOP(OUT_OF_BUDGET) \
+    } else { \
+        ip = code + (target); \
+    }
+#define VM_TRACE(value) \
+    if (Mode & TRACED) trace->record(ip - code, value);
+#define VM_BRANCH(condition, skip) \
+    taken = (condition); \
+    if (Mode & PROFILED) taken_counts[ip - code] += taken; \
+    VM_TRACE(taken) \
+    if (!(Mode & BUDGETED)) ip = taken ? code + ip->operand : ip + (skip); \
+    else if (taken) { VM_JUMP(ip->operand, skip) } \
+    else ip += (skip);
+#define VM_FAIL(msg) { \
+        VM_SAVE_PEAK() \
+        context.depth = sp - base; \
+        context.pc = ip - code; \
+        this->fail(msg); \
+        return; \
+    }
+#define VM_NEED(n, msg) if (Checked && sp - base < (n)) VM_FAIL(msg)
+#define VM_REGISTER(r) if (Checked && ((r) > 7 || (r) < 0)) VM_FAIL("Invalid register number")
+#define VM_LEAVE() \
+    if (Mode & SINGLE_STEP) { \
+        VM_SAVE_PEAK() \
+        context.depth = sp - base; \
+        context.pc = ip - code; \
+        return; \
+    }
+
+#ifdef SVM_COMPUTED_GOTO
+    static const void* const dispatch[NUM_OPCODES] = {
+        &&L_IPUSH, &&L_IPOP, &&L_IDUP, &&L_ISWAP, &&L_IADD, &&L_ISUB, &&L_IMUL, &&L_IDIV,
+        &&L_IGOTO, &&L_IJMPEQ, &&L_IJMPGT, &&L_IJMPGE, &&L_IJMPLT, &&L_IJMPLE,
+        &&L_ISKIP, &&L_ISTORE, &&L_ILOAD, &&L_IPRINT, &&L_OP_HALT,
+        &&L_OP_ADDI, &&L_OP_SUBI, &&L_OP_MULI, &&L_OP_DUPSUBI, &&L_OP_LOADADD, &&L_OP_TEE,
+        &&L_OP_LOAD_JMPEQ, &&L_OP_LOAD_JMPGT, &&L_OP_LOAD_JMPGE, &&L_OP_LOAD_JMPLT, &&L_OP_LOAD_JMPLE };
+#define VM_CASE(op) L_##op: VM_COUNT()
+#define VM_BYTECODE_CASE(op) L_##op: VM_COUNT()
+#define VM_HALT_CASE L_OP_HALT:
+#define VM_NEXT() { VM_LEAVE() goto *dispatch[ip->opcode]; }
+    goto *dispatch[ip->opcode];
+#else
+#define VM_CASE(op) case Instruction::op: VM_COUNT()
+#define VM_BYTECODE_CASE(op) case op: VM_COUNT()
+#define VM_HALT_CASE case OP_HALT:
+#define VM_NEXT() { VM_LEAVE() continue; }
+    for (;;) switch (ip->opcode) {
+#endif
+    VM_CASE(IPUSH)
+        VM_ROOM();
+        *sp++ = ip->operand;
+        ip++;
+        VM_NEXT();
+    VM_CASE(IPOP)
+        VM_NEED(1, "Can't pop from an empty stack");
+        sp--;
+        ip++;
+        VM_NEXT();
+    VM_CASE(IDUP)
+        VM_NEED(1, "Can't dup from an empty stack");
+        VM_ROOM();
+        *sp = sp[-1];
+        sp++;
+        ip++;
+        VM_NEXT();
+    VM_CASE(ISWAP)
+        VM_NEED(2, "Stack underflow in arithmetic or swap");
+        top = sp[-1];
+        sp[-1] = sp[-2];
+        sp[-2] = top;
+        ip++;
+        VM_NEXT();
+    VM_CASE(IADD)
+        VM_NEED(2, "Stack underflow in arithmetic or swap");
+        sp--;
+        sp[-1] += *sp;
+        ip++;
+        VM_NEXT();
+    VM_CASE(ISUB)
+        VM_NEED(2, "Stack underflow in arithmetic or swap");
+        sp--;
+        sp[-1] -= *sp;
+        ip++;
+        VM_NEXT();
+    VM_CASE(IMUL)
+        VM_NEED(2, "Stack underflow in arithmetic or swap");
+        sp--;
+        sp[-1] *= *sp;
+        ip++;
+        VM_NEXT();
+    VM_CASE(IDIV)
+        VM_NEED(2, "Stack underflow in arithmetic or swap");
+        if (sp[-1] == 0) VM_FAIL("Division by zero");
+        if (sp[-1] == -1 && sp[-2] == INT_MIN) VM_FAIL("Integer overflow in division");
+        sp--;
+        sp[-1] /= *sp;
+        ip++;
+        VM_NEXT();
+    VM_CASE(IGOTO)
+        VM_JUMP(ip->operand, 1)
+        VM_NEXT();
+    VM_CASE(IJMPEQ)
+        VM_NEED(2, "Stack underflow in conditional jump");
+        top = *--sp;
+        next = *--sp;
+        VM_BRANCH(next == top, 1)
+        VM_NEXT();
+    VM_CASE(IJMPGT)
+        VM_NEED(2, "Stack underflow in conditional jump");
+        top = *--sp;
+        next = *--sp;
+        VM_BRANCH(next > top, 1)
+        VM_NEXT();
+    VM_CASE(IJMPGE)
+        VM_NEED(2, "Stack underflow in conditional jump");
+        top = *--sp;
+        next = *--sp;
+        VM_BRANCH(next >= top, 1)
+        VM_NEXT();
+    VM_CASE(IJMPLT)
+        VM_NEED(2, "Stack underflow in conditional jump");
+        top = *--sp;
+        next = *--sp;
+        VM_BRANCH(next < top, 1)
+        VM_NEXT();
+    VM_CASE(IJMPLE)
+        VM_NEED(2, "Stack underflow in conditional jump");
+        top = *--sp;
+        next = *--sp;
+        VM_BRANCH(next <= top, 1)
+        VM_NEXT();
+    VM_CASE(ISKIP)
+        ip++;
+        VM_NEXT();
+    VM_CASE(ISTORE)
+        VM_NEED(1, "Can't store from an empty stack");
+        VM_REGISTER(ip->operand);
+        context.registers[ip->operand] = *--sp;
+        VM_TRACE(*sp)
+        ip++;
+        VM_NEXT();
+    VM_CASE(ILOAD)
+        VM_REGISTER(ip->operand);
+        VM_ROOM();
+        *sp++ = context.registers[ip->operand];
+        ip++;
+        VM_NEXT();
+    VM_CASE(IPRINT)
+        context.out->write_stack(base, sp - base);
+        ip++;
+        if (Mode & BUDGETED) VM_STOP(PRINTED)
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_ADDI)
+        VM_NEED(1, "Stack underflow in arithmetic or swap");
+        sp[-1] += ip->operand;
+        ip++;
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_SUBI)
+        VM_NEED(1, "Stack underflow in arithmetic or swap");
+        sp[-1] -= ip->operand;
+        ip++;
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_MULI)
+        VM_NEED(1, "Stack underflow in arithmetic or swap");
+        sp[-1] *= ip->operand;
+        ip++;
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_DUPSUBI)
+        VM_NEED(1, "Can't dup from an empty stack");
+        VM_ROOM();
+        *sp = sp[-1] - ip->operand;
+        sp++;
+        ip++;
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_LOADADD)
+        VM_NEED(1, "Stack underflow in arithmetic or swap");
+        VM_REGISTER(ip->operand);
+        sp[-1] += context.registers[ip->operand];
+        ip++;
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_TEE)
+        VM_NEED(1, "Can't store from an empty stack");
+        VM_REGISTER(ip->operand);
+        context.registers[ip->operand] = sp[-1];
+        VM_TRACE(sp[-1])
+        ip++;
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_LOAD_JMPEQ)
+        reg = ip[1].opcode;
+        VM_REGISTER(reg);
+        VM_BRANCH(context.registers[reg] == ip[1].operand, 2)
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_LOAD_JMPGT)
+        reg = ip[1].opcode;
+        VM_REGISTER(reg);
+        VM_BRANCH(context.registers[reg] > ip[1].operand, 2)
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_LOAD_JMPGE)
+        reg = ip[1].opcode;
+        VM_REGISTER(reg);
+        VM_BRANCH(context.registers[reg] >= ip[1].operand, 2)
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_LOAD_JMPLT)
+        reg = ip[1].opcode;
+        VM_REGISTER(reg);
+        VM_BRANCH(context.registers[reg] < ip[1].operand, 2)
+        VM_NEXT();
+    VM_BYTECODE_CASE(OP_LOAD_JMPLE)
+        reg = ip[1].opcode;
+        VM_REGISTER(reg);
+        VM_BRANCH(context.registers[reg] <= ip[1].operand, 2)
+        VM_NEXT();
+    VM_HALT_CASE
+        VM_STOP(HALTED)
+#ifndef SVM_COMPUTED_GOTO
+    default:
+        VM_FAIL("Programming Error: execute instruction");
+    }
+#endif
+#undef VM_NEED
+#undef VM_ROOM
+#undef VM_REGISTER
+#undef VM_COUNT
+#undef VM_TRACE
+#undef VM_BRANCH
+#undef VM_SAVE_PEAK
+#undef VM_STOP
+#undef VM_JUMP
+#undef VM_FAIL
+#undef VM_LEAVE
+#undef VM_CASE
+#undef VM_BYTECODE_CASE
+#undef VM_HALT_CASE
+#undef VM_NEXT
+}
+
+// Writes the stack in the format of the print instruction and flushes the sink.
+void SVM::print_stack() {
+    context.out->write_stack(context.stack.data(), context.depth);
+    context.out->flush();
+}
+
+void SVM::print() {
+    const Program& program = executable->program;
+    for (int i = 0; i < program.size(); i += op_info[program.data()[i].opcode].words)
+        std::cout << listing_line(program, i) << '\n';
+    std::cout.flush();
+}
+
+void SVM::print_registers() {
+    if (executable->register_vm) executable->register_vm->print();
+}
+
+size_t SVM::code_bytes() { return executable->program.size() * sizeof(Op); }
+
+// False when the stack is empty.
+bool SVM::top(int& value) {
+    if (context.depth == 0) return false;
+    value = context.stack[context.depth - 1];
+    return true;
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include "../include/thread_pool.h"
+
+WorkStealingPool::WorkStealingPool(int count): job(nullptr), generation(0), busy(0), stopping(false) {
+    if (count < 1) count = 1;
+    for (int i = 0; i < count; i++) queues.emplace_back(new Queue());
+    for (int i = 0; i < count; i++) threads.emplace_back(&WorkStealingPool::worker, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+int WorkStealingPool::size() const { return threads.size(); }
+
+bool WorkStealingPool::take(int id, std::pair<size_t, size_t>& chunk) {
+    {
+        Queue& own = *queues[id];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.chunks.empty()) {
+            chunk = own.chunks.back();
+            own.chunks.pop_back();
+            return true;
+        }
+    }
+    for (int k = 1; k < queues.size(); k++) {
+        Queue& victim = *queues[(id + k) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.front();
+            victim.chunks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::worker(int id) {
+    unsigned long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        std::pair<size_t, size_t> chunk;
+        while (this->take(id, chunk)) {
+            for (size_t i = chunk.first; i < chunk.second; i++) (*job)(i, id);
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (--busy == 0) finished.notify_all();
+    }
+}
+
+// Calls job(index, worker) once for every index in [0, count) and returns when all calls have
+// finished. `worker` is in [0, size()) and identifies the calling thread, for per-thread state.
+void WorkStealingPool::parallel_for(size_t count, const std::function<void(size_t, int)>& job) {
+    if (count == 0) return;
+    size_t workers = queues.size();
+    size_t grain = count / (workers * 8);
+    if (grain == 0) grain = 1;
+    size_t chunks = (count + grain - 1) / grain;
+
+    for (size_t w = 0; w < workers; w++) {
+        Queue& queue = *queues[w];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        for (size_t c = w * chunks / workers; c < (w + 1) * chunks / workers; c++)
+            queue.chunks.emplace_back(c * grain, std::min(count, (c + 1) * grain));
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    this->job = &job;
+    busy = workers;
+    generation++;
+    wake.notify_all();
+    finished.wait(guard, [&]() { return busy == 0; });
+    this->job = nullptr;
+}
+
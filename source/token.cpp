@@ -0,0 +1,13 @@
+#include "../include/token.h"
+
+const char* Token::token_names[24] = { "ID", "LABEL", "NUM", "EOL", "ERR", "END", 
+                                       "PUSH", "JMEPEQ", "JMPGT", "JMPGE", "JMPLT", "JMPLE", 
+                                       "GOTO", "SKIP", "POP", "DUP", "SWAP", 
+                                       "ADD", "SUB", "MUL", "DIV", "STORE", "LOAD", "PRINT" };
+
+std::ostream& operator<<(std::ostream& stream, const Token& token) {
+    stream << Token::token_names[token.type];
+    if (!token.lexeme.empty()) stream << "(" << token.lexeme << ")";
+    
+    return stream;
+}
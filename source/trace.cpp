@@ -0,0 +1,357 @@
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <unistd.h>
+#include "../include/image.h"
+#include "../include/mapped_file.h"
+#include "../include/profiler.h"
+#include "../include/trace.h"
+
+namespace {
+
+const char trace_magic[8] = { 'S', 'V', 'M', 'T', 'R', 'A', 'C', 'E' };
+const uint32_t trace_version = 2;
+const size_t header_size = sizeof(trace_magic) + 2 * sizeof(uint32_t);
+
+}
+
+Trace::Trace()
+    : mask(0), head(0), limit(0), published(0), consumed(0), closing(false), write_failed(false), fd(-1) {}
+
+Trace::~Trace() { this->close(); }
+
+// Creates the file, writes its header and starts the flusher. `capacity` is rounded up to a
+// power of two records.
+Status Trace::open(const std::string& path, size_t capacity) {
+    this->close();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return Status(Status::IO_ERROR, "Unable to write file " + path);
+    uint32_t header[2] = { trace_version, sizeof(TraceRecord) };
+    char start[header_size];
+    std::memcpy(start, trace_magic, sizeof(trace_magic));
+    std::memcpy(start + sizeof(trace_magic), header, sizeof(header));
+
+    size_t size = 1024;
+    while (size < capacity) size *= 2;
+    slots.reset(new TraceRecord[size]);
+    mask = size - 1;
+    head = 0;
+    limit = size;
+    published = 0;
+    consumed = 0;
+    closing = false;
+    write_failed = !this->write_all(start, header_size);
+    flusher = std::thread(&Trace::drain, this);
+    return Status();
+}
+
+// Waits for the flusher to write out everything recorded, then closes the file.
+Status Trace::close() {
+    if (fd < 0) return Status();
+    this->publish();
+    closing.store(true, std::memory_order_release);
+    flusher.join();
+    bool failed = write_failed || ::close(fd) != 0;
+    fd = -1;
+    if (failed) return Status(Status::IO_ERROR, "Unable to write the trace");
+    return Status();
+}
+
+bool Trace::write_all(const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = ::write(fd, bytes, length);
+        if (n <= 0) return false;
+        bytes += n;
+        length -= n;
+    }
+    return true;
+}
+
+void Trace::publish() { published.store(head, std::memory_order_release); }
+
+// The ring is full: hands what is there to the flusher and waits until it has written some.
+void Trace::wait_for_room() {
+    this->publish();
+    size_t free;
+    while ((free = consumed.load(std::memory_order_acquire) + mask + 1) == head) std::this_thread::yield();
+    limit = free;
+}
+
+// Flusher thread: writes each published stretch of the ring, in at most two pieces where it
+// wraps around, then frees it for the producer.
+void Trace::drain() {
+    size_t done = 0;
+    for (;;) {
+        size_t ready = published.load(std::memory_order_acquire);
+        if (ready == done) {
+            if (closing.load(std::memory_order_acquire) && published.load(std::memory_order_acquire) == done) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        while (done < ready) {
+            size_t from = done & mask;
+            size_t count = std::min(ready - done, mask + 1 - from);
+            if (!this->write_all(&slots[from], count * sizeof(TraceRecord))) write_failed = true;
+            done += count;
+        }
+        consumed.store(done, std::memory_order_release);
+    }
+}
+
+namespace {
+
+uint32_t code_checksum(const Program& program) {
+    return static_cast<uint32_t>(image::checksum(reinterpret_cast<const char*>(program.data()), program.size() * sizeof(Op)));
+}
+
+}
+
+void Trace::begin(const Program& program, int pc, const int* registers, const int* stack, int depth) {
+    this->record(TRACE_BEGIN, pc);
+    this->record(TRACE_PROGRAM, program.size());
+    this->record(TRACE_CHECKSUM, code_checksum(program));
+    for (int i = 0; i < 8; i++) this->record(TRACE_REGISTER, registers[i]);
+    for (int i = 0; i < depth; i++) this->record(TRACE_STACK, stack[i]);
+}
+
+void Trace::end(int pc, bool failed, long long steps) {
+    this->record(TRACE_STEPS, static_cast<int32_t>(static_cast<uint32_t>(steps)));
+    this->record(TRACE_STEPS, static_cast<int32_t>(static_cast<uint64_t>(steps) >> 32));
+    this->record(failed ? TRACE_FAILED : TRACE_HALTED, pc);
+    this->publish();
+}
+
+namespace {
+
+// Walks the program along a trace: conditional jumps go the way the trace says, stores take
+// the recorded value, and everything in between is evaluated on a private stack and register
+// file. The recorded outcomes are checked against the evaluated ones, so a trace replayed with
+// the wrong program stops with an error instead of showing a made-up state.
+class Replayer {
+private:
+    const Program& program;
+    const char* records;
+    size_t count, next;
+    int start;
+    long long run_start;
+    ReplayState& state;
+
+    TraceRecord at(size_t i) const {
+        TraceRecord r;
+        std::memcpy(&r, records + i * sizeof(TraceRecord), sizeof(TraceRecord));
+        return r;
+    }
+
+    Status mismatch(int pc) const {
+        return Status(Status::INVALID_INPUT, "The trace does not match the program at pc " + std::to_string(pc) +
+                                             "; replay it with the program and -O level it was recorded with");
+    }
+
+    Status begin_run();
+    Status walk(long long step, bool& reached);
+
+public:
+    Replayer(const Program& program, std::string_view data, ReplayState& state)
+        : program(program), records(data.data()), count(data.size() / sizeof(TraceRecord)), next(0), start(0), run_start(0), state(state) {}
+
+    Status run(long long step);
+};
+
+Status Replayer::begin_run() {
+    if (count - next < 11 || this->at(next).pc != TRACE_BEGIN || this->at(next + 1).pc != TRACE_PROGRAM ||
+        this->at(next + 2).pc != TRACE_CHECKSUM)
+        return Status(Status::INVALID_IMAGE, "Corrupt trace record " + std::to_string(next));
+    if (this->at(next + 1).value != static_cast<int32_t>(program.size()) ||
+        static_cast<uint32_t>(this->at(next + 2).value) != code_checksum(program))
+        return Status(Status::INVALID_INPUT, "The trace was recorded from a different program; replay it with the "
+                                             "program and -O level it was recorded with");
+    start = this->at(next).value;
+    run_start = state.step;
+    state.pc = -1;
+    state.ended = state.failed = false;
+    state.run++;
+    state.stack.clear();
+    next += 3;
+    for (int i = 0; i < 8; i++) {
+        TraceRecord r = this->at(next++);
+        if (r.pc != TRACE_REGISTER) return Status(Status::INVALID_IMAGE, "Corrupt trace record " + std::to_string(next - 1));
+        state.registers[i] = r.value;
+    }
+    while (next < count && this->at(next).pc == TRACE_STACK) state.stack.push_back(this->at(next++).value);
+    return Status();
+}
+
+// Runs one traced run from the pc in its BEGIN record until its HALTED/FAILED record, the end
+// of a truncated trace or `step`.
+Status Replayer::walk(long long step, bool& reached) {
+    const Op* code = program.data();
+    std::vector<int>& stack = state.stack;
+    int* registers = state.registers;
+    int pc = start;
+    size_t unrecorded = 0;
+
+    for (;;) {
+        // The run ends exactly after as many instructions as its end record says, wherever the
+        // same pc was reached before.
+        if (count - next >= 3 && this->at(next).pc == TRACE_STEPS) {
+            TraceRecord low = this->at(next), high = this->at(next + 1), end = this->at(next + 2);
+            if (high.pc != TRACE_STEPS || (end.pc != TRACE_HALTED && end.pc != TRACE_FAILED))
+                return Status(Status::INVALID_IMAGE, "Corrupt trace record " + std::to_string(next));
+            long long steps = static_cast<long long>(static_cast<uint64_t>(static_cast<uint32_t>(high.value)) << 32 |
+                                                     static_cast<uint32_t>(low.value));
+            if (state.step - run_start == steps) {
+                if (end.value != pc) return this->mismatch(pc);
+                state.ended = true;
+                state.failed = end.pc == TRACE_FAILED;
+                next += 3;
+                return Status();
+            }
+        }
+        // Past the last record of a trace that was cut short, only unconditional code is left.
+        if (next == count && ++unrecorded > program.size()) return Status();
+        if (step >= 0 && state.step == step) {
+            reached = true;
+            return Status();
+        }
+        if (pc < 0 || pc >= static_cast<int>(program.size())) return next == count ? Status() : this->mismatch(pc);
+
+        const Op& op = code[pc];
+        const OpInfo& info = op_info[op.opcode];
+        if (stack.size() < static_cast<size_t>(info.pops)) return this->mismatch(pc);
+        TraceRecord event = TraceRecord{ pc, 0 };
+        bool recorded = (op.opcode >= Instruction::IJMPEQ && op.opcode <= Instruction::IJMPLE) ||
+                        op.opcode == Instruction::ISTORE || op.opcode == OP_TEE ||
+                        (op.opcode >= OP_LOAD_JMPEQ && op.opcode <= OP_LOAD_JMPLE);
+        if (recorded) {
+            if (next == count) return Status();
+            event = this->at(next++);
+            if (event.pc != pc) return this->mismatch(pc);
+        }
+        int reg = Program::uses_register(op.opcode) ? op.operand : 0;
+        if (reg < 0 || reg > 7) return this->mismatch(pc);
+
+        int a = stack.empty() ? 0 : stack.back();
+        int b = stack.size() < 2 ? 0 : stack[stack.size() - 2];
+        int compared = 0, against = 0;
+        int target = pc + info.words;
+        switch (op.opcode) {
+            case Instruction::IPUSH: stack.push_back(op.operand); break;
+            case Instruction::IPOP: stack.pop_back(); break;
+            case Instruction::IDUP: stack.push_back(a); break;
+            case Instruction::ISWAP: std::swap(stack.back(), stack[stack.size() - 2]); break;
+            case Instruction::IADD: stack.pop_back(); stack.back() = b + a; break;
+            case Instruction::ISUB: stack.pop_back(); stack.back() = b - a; break;
+            case Instruction::IMUL: stack.pop_back(); stack.back() = b * a; break;
+            case Instruction::IDIV:
+                if (a == 0 || (a == -1 && b == std::numeric_limits<int>::min())) return this->mismatch(pc);
+                stack.pop_back();
+                stack.back() = b / a;
+                break;
+            case Instruction::IGOTO: target = op.operand; break;
+            case Instruction::IJMPEQ: case Instruction::IJMPGT: case Instruction::IJMPGE:
+            case Instruction::IJMPLT: case Instruction::IJMPLE:
+                stack.resize(stack.size() - 2);
+                compared = b;
+                against = a;
+                break;
+            case Instruction::ISTORE:
+                if (event.value != a) return this->mismatch(pc);
+                registers[reg] = a;
+                stack.pop_back();
+                break;
+            case Instruction::ILOAD: stack.push_back(registers[reg]); break;
+            case OP_ADDI: stack.back() = a + op.operand; break;
+            case OP_SUBI: stack.back() = a - op.operand; break;
+            case OP_MULI: stack.back() = a * op.operand; break;
+            case OP_DUPSUBI: stack.push_back(a - op.operand); break;
+            case OP_LOADADD: stack.back() = a + registers[reg]; break;
+            case OP_TEE:
+                if (event.value != a) return this->mismatch(pc);
+                registers[reg] = a;
+                break;
+            case OP_LOAD_JMPEQ: case OP_LOAD_JMPGT: case OP_LOAD_JMPGE: case OP_LOAD_JMPLT: case OP_LOAD_JMPLE:
+                if (code[pc + 1].opcode > 7) return this->mismatch(pc);
+                compared = registers[code[pc + 1].opcode];
+                against = code[pc + 1].operand;
+                break;
+            default: break;
+        }
+        state.taken = false;
+        if (recorded && op.opcode != Instruction::ISTORE && op.opcode != OP_TEE) {
+            uint32_t kind = op.opcode >= OP_LOAD_JMPEQ ? op.opcode - OP_LOAD_JMPEQ : op.opcode - Instruction::IJMPEQ;
+            bool expected = kind == 0 ? compared == against : kind == 1 ? compared > against :
+                            kind == 2 ? compared >= against : kind == 3 ? compared < against : compared <= against;
+            if (event.value != expected) return this->mismatch(pc);
+            state.taken = expected;
+            if (expected) target = op.operand;
+        }
+        state.pc = pc;
+        state.step++;
+        pc = target;
+    }
+}
+
+Status Replayer::run(long long step) {
+    std::fill(state.registers, state.registers + 8, 0);
+    state.stack.clear();
+    state.step = 0;
+    state.run = 0;
+    state.pc = -1;
+    state.taken = state.ended = state.failed = false;
+    while (next < count) {
+        if (step >= 0 && state.step == step && state.run > 0) return Status();
+        Status status = this->begin_run();
+        if (!status.ok()) return status;
+        bool reached = false;
+        status = this->walk(step, reached);
+        if (!status.ok() || reached) return status;
+    }
+    if (step > state.step) return Status(Status::INVALID_INPUT, "The trace has only " + std::to_string(state.step) + " steps");
+    return Status();
+}
+
+}
+
+// Rebuilds the state after the first `step` instructions of the trace, across all its runs, or
+// after all of them when `step` is negative. `program` must be the one that was traced.
+Status replay_trace(const Program& program, const std::string& path, long long step, ReplayState& state) {
+    MappedFile file(path);
+    if (!file.is_open()) return Status(Status::IO_ERROR, "Unable to open file " + path);
+    std::string_view data = file.view();
+    uint32_t header[2];
+    if (data.size() < header_size || std::memcmp(data.data(), trace_magic, sizeof(trace_magic)) != 0)
+        return Status(Status::INVALID_IMAGE, path + " is not an execution trace");
+    std::memcpy(header, data.data() + sizeof(trace_magic), sizeof(header));
+    if (header[0] != trace_version || header[1] != sizeof(TraceRecord))
+        return Status(Status::INVALID_IMAGE, path + " was written by an incompatible version");
+    return Replayer(program, data.substr(header_size), state).run(step);
+}
+
+// Prints the instruction at `step` (the last one when negative) with the registers and the stack,
+// top first as print_stack() shows it, that it left behind.
+Status inspect_trace(const Program& program, const std::string& path, long long step, std::ostream& out) {
+    ReplayState state;
+    Status status = replay_trace(program, path, -1, state);
+    if (!status.ok()) return status;
+    out << "Trace " << path << ": " << state.run << " run(s), " << state.step << " instructions" << std::endl;
+    if (step >= 0) status = replay_trace(program, path, step, state);
+    if (!status.ok()) return status;
+
+    if (state.pc < 0) {
+        out << "step 0: before the first instruction" << std::endl;
+    } else {
+        out << "step " << state.step << " (run " << state.run << "): " << listing_line(program, state.pc);
+        if (Program::is_jump(program.data()[state.pc].opcode) && program.data()[state.pc].opcode != Instruction::IGOTO)
+            out << (state.taken ? " (taken)" : " (not taken)");
+        out << std::endl;
+    }
+    out << "registers [ ";
+    for (int i = 0; i < 8; i++) out << state.registers[i] << " ";
+    out << "]" << std::endl << "stack [ ";
+    for (size_t i = state.stack.size(); i > 0; i--) out << state.stack[i - 1] << " ";
+    out << "]" << std::endl;
+    if (state.ended) out << "run " << state.run << (state.failed ? " failed" : " finished") << std::endl;
+    return Status();
+}
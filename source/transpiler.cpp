@@ -0,0 +1,209 @@
+#include "../include/transpiler.h"
+
+// Runtime pasted at the top of every translation unit. Arithmetic wraps like the interpreter
+// does instead of relying on signed overflow, which the optimizer is free to assume away, and
+// a division the interpreter refuses fails here with the same message.
+const char* cpp_runtime = R"(#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+inline int svm_add(int a, int b) { return (int)((unsigned)a + (unsigned)b); }
+inline int svm_sub(int a, int b) { return (int)((unsigned)a - (unsigned)b); }
+inline int svm_mul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }
+
+inline void svm_fail(const char* msg) {
+    std::printf("error: %s\n", msg);
+    std::exit(0);
+}
+
+inline int svm_div(int a, int b) {
+    if (b == 0) svm_fail("Division by zero");
+    if (a == INT_MIN && b == -1) svm_fail("Integer overflow in division");
+    return a / b;
+}
+
+inline void svm_print(std::initializer_list<int> top_first) {
+    std::printf("stack [ ");
+    for (int value : top_first) std::printf("%d ", value);
+    std::printf("]\n");
+}
+
+struct svm_stack {
+    std::vector<int> v;
+
+    void need(size_t n, const char* msg) { if (v.size() < n) svm_fail(msg); }
+    int pop() { int value = v.back(); v.pop_back(); return value; }
+    void print() {
+        std::printf("stack [ ");
+        for (size_t i = v.size(); i-- > 0;) std::printf("%d ", v[i]);
+        std::printf("]\n");
+    }
+};
+)";
+
+// Writes `program` as a self-contained C++ translation unit whose main() prints the same output
+// as SVM::execute() followed by print_stack(). Every jump target becomes a goto label. Verified
+// programs keep stack slot k in local s<k>, since each pc has a fixed depth; anything else runs
+// on a growable svm_stack with the interpreter's runtime checks and error messages.
+class CppEmitter {
+private:
+    const Program& program;
+    const Verification& verification;
+    std::ostream& out;
+    Status failure;
+
+public:
+    CppEmitter(const Program&, const Verification&, std::ostream&);
+    Status emit();
+
+private:
+    void emit_slots(int);
+    void emit_verified(int, const Op&, int);
+    void emit_checked(int, const Op&);
+    static const char* comparison(uint32_t);
+};
+
+CppEmitter::CppEmitter(const Program& program, const Verification& verification, std::ostream& out)
+    : program(program), verification(verification), out(out) {}
+
+const char* CppEmitter::comparison(uint32_t opcode) {
+    switch (opcode) {
+        case Instruction::IJMPEQ: case OP_LOAD_JMPEQ: return "==";
+        case Instruction::IJMPGT: case OP_LOAD_JMPGT: return ">";
+        case Instruction::IJMPGE: case OP_LOAD_JMPGE: return ">=";
+        case Instruction::IJMPLT: case OP_LOAD_JMPLT: return "<";
+        default: return "<=";
+    }
+}
+
+// Prints the top `depth` locals as an initializer list, top of stack first.
+void CppEmitter::emit_slots(int depth) {
+    out << "svm_print({";
+    for (int k = depth - 1; k >= 0; k--) out << " s" << k << (k ? "," : " ");
+    out << "});";
+}
+
+void CppEmitter::emit_verified(int pc, const Op& op, int d) {
+    const Op* code = program.data();
+    int k = op.operand;
+    switch (op.opcode) {
+        case Instruction::IPUSH: out << "s" << d << " = " << k << ";"; break;
+        case Instruction::IPOP: case Instruction::ISKIP: out << ";"; break;
+        case Instruction::IDUP: out << "s" << d << " = s" << d - 1 << ";"; break;
+        case Instruction::ISWAP: out << "std::swap(s" << d - 2 << ", s" << d - 1 << ");"; break;
+        case Instruction::IADD: out << "s" << d - 2 << " = svm_add(s" << d - 2 << ", s" << d - 1 << ");"; break;
+        case Instruction::ISUB: out << "s" << d - 2 << " = svm_sub(s" << d - 2 << ", s" << d - 1 << ");"; break;
+        case Instruction::IMUL: out << "s" << d - 2 << " = svm_mul(s" << d - 2 << ", s" << d - 1 << ");"; break;
+        case Instruction::IDIV: out << "s" << d - 2 << " = svm_div(s" << d - 2 << ", s" << d - 1 << ");"; break;
+        case Instruction::IGOTO: out << "goto pc_" << k << ";"; break;
+        case Instruction::IJMPEQ: case Instruction::IJMPGT: case Instruction::IJMPGE:
+        case Instruction::IJMPLT: case Instruction::IJMPLE:
+            out << "if (s" << d - 2 << " " << comparison(op.opcode) << " s" << d - 1 << ") goto pc_" << k << ";";
+            break;
+        case Instruction::ISTORE: out << "r" << k << " = s" << d - 1 << ";"; break;
+        case Instruction::ILOAD: out << "s" << d << " = r" << k << ";"; break;
+        case Instruction::IPRINT: this->emit_slots(d); break;
+        case OP_ADDI: out << "s" << d - 1 << " = svm_add(s" << d - 1 << ", " << k << ");"; break;
+        case OP_SUBI: out << "s" << d - 1 << " = svm_sub(s" << d - 1 << ", " << k << ");"; break;
+        case OP_MULI: out << "s" << d - 1 << " = svm_mul(s" << d - 1 << ", " << k << ");"; break;
+        case OP_DUPSUBI: out << "s" << d << " = svm_sub(s" << d - 1 << ", " << k << ");"; break;
+        case OP_LOADADD: out << "s" << d - 1 << " = svm_add(s" << d - 1 << ", r" << k << ");"; break;
+        case OP_TEE: out << "r" << k << " = s" << d - 1 << ";"; break;
+        default:
+            out << "if (r" << code[pc + 1].opcode << " " << comparison(op.opcode) << " " << code[pc + 1].operand
+                << ") goto pc_" << k << ";";
+            break;
+    }
+}
+
+void CppEmitter::emit_checked(int pc, const Op& op) {
+    int k = op.operand;
+    bool bad_register = Program::uses_register(op.opcode) && (k < 0 || k > 7);
+    switch (op.opcode) {
+        case Instruction::IPUSH: out << "S.v.push_back(" << k << ");"; break;
+        case Instruction::IPOP: out << "S.need(1, \"Can't pop from an empty stack\"); S.v.pop_back();"; break;
+        case Instruction::IDUP: out << "S.need(1, \"Can't dup from an empty stack\"); S.v.push_back(S.v.back());"; break;
+        case Instruction::ISWAP:
+            out << "S.need(2, \"Stack underflow in arithmetic or swap\"); std::swap(S.v[S.v.size() - 1], S.v[S.v.size() - 2]);";
+            break;
+        case Instruction::IADD: case Instruction::ISUB: case Instruction::IMUL: case Instruction::IDIV:
+            out << "S.need(2, \"Stack underflow in arithmetic or swap\"); b = S.pop(); ";
+            if (op.opcode == Instruction::IADD) out << "S.v.back() = svm_add(S.v.back(), b);";
+            else if (op.opcode == Instruction::ISUB) out << "S.v.back() = svm_sub(S.v.back(), b);";
+            else if (op.opcode == Instruction::IMUL) out << "S.v.back() = svm_mul(S.v.back(), b);";
+            else out << "S.v.back() = svm_div(S.v.back(), b);";
+            break;
+        case Instruction::IGOTO: out << "goto pc_" << k << ";"; break;
+        case Instruction::IJMPEQ: case Instruction::IJMPGT: case Instruction::IJMPGE:
+        case Instruction::IJMPLT: case Instruction::IJMPLE:
+            out << "S.need(2, \"Stack underflow in conditional jump\"); b = S.pop(); a = S.pop(); if (a "
+                << comparison(op.opcode) << " b) goto pc_" << k << ";";
+            break;
+        case Instruction::ISKIP: out << ";"; break;
+        case Instruction::ISTORE:
+            out << "S.need(1, \"Can't store from an empty stack\"); ";
+            if (bad_register) out << "svm_fail(\"Invalid register number\");";
+            else out << "r" << k << " = S.pop();";
+            break;
+        case Instruction::ILOAD:
+            if (bad_register) out << "svm_fail(\"Invalid register number\");";
+            else out << "S.v.push_back(r" << k << ");";
+            break;
+        case Instruction::IPRINT: out << "S.print();"; break;
+        default:
+            failure = Status(Status::INVALID_INPUT, "Cannot translate " + std::string(op_info[op.opcode].name) +
+                             " at " + std::to_string(pc) + " in an unverified program");
+    }
+}
+
+Status CppEmitter::emit() {
+    const Op* code = program.data();
+    int n = program.size();
+    bool verified = verification.ok;
+
+    std::vector<bool> target(n + 1, false);
+    for (int pc = 0; pc < n; pc += op_info[code[pc].opcode].words) {
+        if (Program::is_jump(code[pc].opcode) && (!verified || verification.depth[pc] >= 0))
+            target[code[pc].operand] = true;
+    }
+
+    out << cpp_runtime << "\nint main() {\n";
+    out << "    int r0 = 0, r1 = 0, r2 = 0, r3 = 0, r4 = 0, r5 = 0, r6 = 0, r7 = 0;\n";
+    if (verified) {
+        for (int k = 0; k < verification.max_depth; k++) out << "    int s" << k << " = 0;\n";
+    } else {
+        out << "    svm_stack S;\n    int a = 0, b = 0;\n";
+    }
+
+    for (int pc = 0; pc < n; pc += op_info[code[pc].opcode].words) {
+        if (verified && verification.depth[pc] < 0) continue;
+        if (target[pc]) out << "pc_" << pc << ":\n";
+
+        const Op& op = code[pc];
+        std::string_view label = program.debug.label_at(pc);
+        out << "    ";
+        if (verified) this->emit_verified(pc, op, verification.depth[pc]);
+        else this->emit_checked(pc, op);
+        out << " // " << op_info[op.opcode].name;
+        if (label != "") out << " (" << label << ")";
+        out << "\n";
+    }
+
+    if (target[n]) out << "pc_" << n << ":\n";
+    out << "    ";
+    if (!verified) out << "S.print();";
+    else if (verification.depth[n] >= 0) this->emit_slots(verification.depth[n]);
+    else out << ";";
+    out << "\n    (void)r0; (void)r1; (void)r2; (void)r3; (void)r4; (void)r5; (void)r6; (void)r7;\n";
+    if (!verified) out << "    (void)a; (void)b;\n";
+    out << "    return 0;\n}\n";
+    return failure;
+}
+
+Status emit_cpp(const Program& program, std::ostream& out) {
+    Verification verification = verify(program);
+    return CppEmitter(program, verification, out).emit();
+}
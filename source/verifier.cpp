@@ -0,0 +1,73 @@
+#include "../include/verifier.h"
+
+Verification verify(const Program& program) {
+    Verification result;
+    verify(program, result);
+    return result;
+}
+
+// Overwrites `result`, reusing its depth table and worklist.
+void verify(const Program& program, Verification& result) {
+    result.ok = true;
+    result.error.clear();
+    result.max_depth = 0;
+    result.error_pc = -1;
+    result.depth.assign(program.size() + 1, -1);
+
+    const Op* code = program.data();
+    std::vector<int>& worklist = result.worklist;
+    worklist.clear();
+
+    result.depth[0] = 0;
+    worklist.push_back(0);
+
+    while (!worklist.empty()) {
+        int pc = worklist.back();
+        worklist.pop_back();
+
+        const Op& op = code[pc];
+        int depth = result.depth[pc];
+        if (depth < op_info[op.opcode].pops) {
+            result.error = std::string("stack underflow in ") + op_info[op.opcode].name;
+            result.error_pc = pc;
+            break;
+        }
+        int reg = op.opcode >= OP_LOAD_JMPEQ && op.opcode <= OP_LOAD_JMPLE ? (int)code[pc + 1].opcode
+                : Program::uses_register(op.opcode) ? op.operand : 0;
+        if (reg < 0 || reg > 7) {
+            result.error = "invalid register number";
+            result.error_pc = pc;
+            break;
+        }
+
+        int after = depth - op_info[op.opcode].pops + op_info[op.opcode].pushes;
+        if (after > result.max_depth) result.max_depth = after;
+
+        int successors[2];
+        int count = 0;
+        if (op.opcode == OP_HALT) {
+            count = 0;
+        } else if (op.opcode == Instruction::IGOTO) {
+            successors[count++] = op.operand;
+        } else {
+            successors[count++] = pc + op_info[op.opcode].words;
+            if (Program::is_jump(op.opcode)) successors[count++] = op.operand;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int target = successors[i];
+            if (result.depth[target] == -1) {
+                result.depth[target] = after;
+                worklist.push_back(target);
+            } else if (result.depth[target] != after) {
+                result.error = "inconsistent stack depth at join";
+                result.error_pc = target;
+                break;
+            }
+        }
+        if (result.error_pc != -1) break;
+    }
+
+    result.ok = result.error_pc == -1;
+}
+